@@ -0,0 +1,269 @@
+#!/usr/bin/env python3
+"""
+Benchmarks for naturebindgen.
+
+    python bench.py lexer [--sdl3 <include dir>] [header ...]
+
+times expr_ast.tokenize over the replacement list of every #define in
+tests/raylib.h, any extra headers given, and the SDL3 headers when their
+include directory is passed (or set in $SDL3_INCLUDE_DIR).
+
+    python bench.py run [--sdl3 <include dir>] [--synthetic N ...]
+                        [--output results.json] [--baseline old.json]
+
+runs the whole generator over the tests/ headers, SDL.h and synthetic headers
+of N structs/macros, each in a fresh process, and records wall time per phase,
+event counters, libclang calls, peak RSS and output size. With --baseline it
+exits non-zero when a target got slower, bigger or hungrier than allowed.
+"""
+import argparse
+import concurrent.futures
+import glob
+import json
+import os
+import platform
+import re
+import sys
+import tempfile
+import time
+import timeit
+from typing import Any, Dict, List, Tuple
+
+from expr_ast import parse_macro_tokens, tokenize
+
+TESTS_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), "tests")
+DEFAULT_LEXER_HEADERS = [os.path.join(TESTS_DIR, "raylib.h")]
+DEFAULT_RUN_HEADERS = [os.path.join(TESTS_DIR, name) for name in ("raylib.h", "comprehensive_test.h", "cursed.h")]
+
+# Bump when the layout of the `run` JSON changes
+RESULTS_VERSION = 1
+# Wall time differences below this are noise on small headers, whatever the ratio
+TIME_NOISE_FLOOR = 0.05
+
+_COMMENT_RE = re.compile(r"/\*[\s\S]*?\*/|//[^\n]*")
+_DEFINE_RE = re.compile(r"^[ \t]*#[ \t]*define[ \t]+\w+(?:\([^)]*\))?[ \t]*(.*)$", re.MULTILINE)
+
+
+def sdl3_headers(include_dir: str) -> List[str]:
+    """Public SDL3 headers under an include directory (the one holding SDL3/)."""
+    return sorted(glob.glob(os.path.join(include_dir, "SDL3", "*.h"))) or \
+        sorted(glob.glob(os.path.join(include_dir, "*.h")))
+
+
+def macro_bodies(paths: List[str]) -> List[str]:
+    """Replacement text of every #define in paths, comments removed and continuations joined."""
+    bodies: List[str] = []
+    for path in paths:
+        with open(path, encoding="utf-8", errors="replace") as f:
+            text = f.read().replace("\\\n", " ")
+        text = _COMMENT_RE.sub("", text)
+        bodies.extend(m.group(1).strip() for m in _DEFINE_RE.finditer(text))
+    return [b for b in bodies if b]
+
+
+def bench_lexer(bodies: List[str], repeat: int = 5) -> Dict[str, float]:
+    """Best-of-repeat time to tokenize every body once, plus what the tokens amount to."""
+    token_lists = [tokenize(b) for b in bodies]
+    tokens = sum(len(t) for t in token_lists)
+    timer = timeit.Timer(lambda: [tokenize(b) for b in bodies])
+    number, _ = timer.autorange()
+    best = min(timer.repeat(repeat=repeat, number=number)) / number
+    return {
+        "macros": len(bodies),
+        "tokens": tokens,
+        "parsed": sum(parse_macro_tokens(t) is not None for t in token_lists),
+        "seconds_per_pass": best,
+        "ns_per_token": best / tokens * 1e9 if tokens else 0.0,
+    }
+
+
+def _lexer_command(args: argparse.Namespace) -> Dict[str, object]:
+    paths = DEFAULT_LEXER_HEADERS + args.headers
+    if args.sdl3:
+        found = sdl3_headers(args.sdl3)
+        if not found:
+            sys.exit(f"no SDL3 headers under {args.sdl3}")
+        paths += found
+    result = bench_lexer(macro_bodies(paths), args.repeat)
+    if not args.json:
+        print(f"headers:       {len(paths)}")
+        print(f"macros:        {result['macros']} ({result['parsed']} parse as expressions)")
+        print(f"tokens:        {result['tokens']}")
+        print(f"per pass:      {result['seconds_per_pass'] * 1000:.3f} ms")
+        print(f"per token:     {result['ns_per_token']:.0f} ns")
+    return {"lexer": result}
+
+
+def write_synthetic_header(path: str, n: int):
+    """
+    A header scaling with n: n structs chained by pointer, n macros (integer,
+    float, shifted and referencing earlier ones), an anonymous union in every
+    tenth struct and a function per ten structs.
+    """
+    with open(path, "w") as f:
+        f.write(f"#ifndef SYNTHETIC_{n}_H\n#define SYNTHETIC_{n}_H\n\n")
+        for i in range(n):
+            prev = f"struct S{i - 1} *prev;" if i else "void *prev;"
+            if i % 10 == 0:
+                f.write(f"typedef struct S{i} {{ int tag; union {{ int i; float f; }} value; {prev} }} S{i};\n")
+                f.write(f"S{i} *make_s{i}(int tag, float value);\n")
+            else:
+                f.write(f"typedef struct S{i} {{ int a; float b; char name[{i % 32 + 1}]; {prev} }} S{i};\n")
+            if i % 3 == 0:
+                f.write(f"#define M{i} {i}.5f\n")
+            elif i % 3 == 1:
+                f.write(f"#define M{i} (1u << {i % 31})\n")
+            else:
+                f.write(f"#define M{i} (M{i - 1} | {i})\n")
+        f.write("\n#endif\n")
+
+
+def _run_target(header: str, clang_args: List[str], count_calls: bool) -> Dict[str, Any]:
+    """One generator run over header, in a fresh worker process."""
+    import instrument
+    from main import Job, run_job
+    instrument.configure_logging("warning")
+    calls = instrument.count_libclang_calls() if count_calls else None
+    fd, output = tempfile.mkstemp(suffix=".n")
+    os.close(fd)
+    options = argparse.Namespace(cache_dir=None, incremental=False, timings=False, check=False)
+    try:
+        start = time.perf_counter()
+        run_job(Job(header=header, output=output, clang_args=clang_args), options)
+        wall = time.perf_counter() - start
+        output_bytes = os.path.getsize(output)
+    finally:
+        os.remove(output)
+    result = instrument.timings.snapshot()
+    result.update(wall_seconds=wall, output_bytes=output_bytes)
+    if calls is not None:
+        result["libclang_calls"] = sum(calls.values())
+        result["libclang_top"] = dict(sorted(calls.items(), key=lambda kv: -kv[1])[:10])
+    return result
+
+
+def _run_targets(args: argparse.Namespace, scratch: str) -> List[Tuple[str, str, List[str]]]:
+    """(name, header, clang args) for everything the run command measures."""
+    targets = [(os.path.basename(h), h, []) for h in DEFAULT_RUN_HEADERS + args.headers]
+    if args.sdl3:
+        umbrella = os.path.join(args.sdl3, "SDL3", "SDL.h")
+        if not os.path.exists(umbrella):
+            sys.exit(f"no SDL3/SDL.h under {args.sdl3}")
+        targets.append(("SDL3/SDL.h", umbrella, [f"-I{args.sdl3}"]))
+    for n in args.synthetic:
+        path = os.path.join(scratch, f"synthetic_{n}.h")
+        write_synthetic_header(path, n)
+        targets.append((f"synthetic-{n}", path, []))
+    return targets
+
+
+def compare(results: Dict[str, Any], baseline: Dict[str, Any], time_tolerance: float,
+            size_tolerance: float) -> List[str]:
+    """Regressions of results against baseline, as readable lines."""
+    regressions: List[str] = []
+    checks = [("wall_seconds", time_tolerance), ("peak_rss_kib", size_tolerance),
+              ("output_bytes", size_tolerance), ("libclang_calls", 0.0)]
+    for name, current in results["targets"].items():
+        old = baseline.get("targets", {}).get(name)
+        if old is None:
+            continue
+        for metric, tolerance in checks:
+            before, after = old.get(metric), current.get(metric)
+            if before is None or after is None:
+                continue
+            if metric == "wall_seconds" and after - before < TIME_NOISE_FLOOR:
+                continue
+            if after > before * (1 + tolerance):
+                change = (after / before - 1) * 100 if before else float("inf")
+                regressions.append(f"{name}: {metric} {before:g} -> {after:g} (+{change:.1f}%)")
+    return regressions
+
+
+def _run_command(args: argparse.Namespace) -> Dict[str, Any]:
+    results: Dict[str, Any] = {
+        "version": RESULTS_VERSION,
+        "python": platform.python_version(),
+        "platform": platform.platform(),
+        "repeat": args.repeat,
+        "targets": {},
+    }
+    with tempfile.TemporaryDirectory() as scratch:
+        targets = _run_targets(args, scratch)
+        # A fresh process per run, so peak RSS and caches belong to that run alone
+        with concurrent.futures.ProcessPoolExecutor(max_workers=1, max_tasks_per_child=1) as pool:
+            for name, header, clang_args in targets:
+                runs = [pool.submit(_run_target, header, clang_args, args.count_calls).result()
+                        for _ in range(args.repeat)]
+                best = min(runs, key=lambda r: r["wall_seconds"])
+                results["targets"][name] = best
+                if not args.json:
+                    print(f"{name:<24} {best['wall_seconds'] * 1000:10.1f} ms "
+                          f"{(best['peak_rss_kib'] or 0) / 1024:8.1f} MiB {best['output_bytes']:10d} B")
+
+    if args.output:
+        with open(args.output, "w") as f:
+            json.dump(results, f, indent=2)
+    if args.baseline:
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+        regressions = compare(results, baseline, args.time_tolerance, args.size_tolerance)
+        for line in regressions:
+            print(f"REGRESSION: {line}", file=sys.stderr)
+        if regressions:
+            if args.json:
+                json.dump(results, sys.stdout, indent=2)
+                print()
+            sys.exit(1)
+    return results
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Benchmarks for naturebindgen.")
+    parser.add_argument("--json", action="store_true", help="Print results as JSON instead of a table.")
+    commands = parser.add_subparsers(dest="command", required=True)
+
+    lexer = commands.add_parser("lexer", help="Time expr_ast.tokenize over real macro definitions.")
+    lexer.add_argument("headers", nargs="*", help="Extra headers whose macros are lexed.")
+    lexer.add_argument(
+        "--sdl3", default=os.getenv("SDL3_INCLUDE_DIR"),
+        help="SDL3 include directory (default: $SDL3_INCLUDE_DIR)."
+    )
+    lexer.add_argument("--repeat", type=int, default=5, help="Timing repetitions; the best is reported.")
+    lexer.set_defaults(run=_lexer_command)
+
+    run = commands.add_parser("run", help="Time full generator runs and optionally gate on a baseline.")
+    run.add_argument("headers", nargs="*", help="Extra headers to bind besides the tests/ ones.")
+    run.add_argument(
+        "--sdl3", default=os.getenv("SDL3_INCLUDE_DIR"),
+        help="SDL3 include directory; binds SDL3/SDL.h (default: $SDL3_INCLUDE_DIR)."
+    )
+    run.add_argument(
+        "--synthetic", type=int, nargs="+", default=[], metavar="N",
+        help="Also bind generated headers with N structs and macros each (e.g. 10000 100000)."
+    )
+    run.add_argument("--repeat", type=int, default=1, help="Runs per target; the fastest is reported.")
+    run.add_argument(
+        "--count-calls", action="store_true",
+        help="Count libclang calls too (adds overhead to the timings of that run)."
+    )
+    run.add_argument("-o", "--output", help="Write the results JSON here.")
+    run.add_argument("--baseline", help="Results JSON from an earlier run to compare against.")
+    run.add_argument(
+        "--time-tolerance", type=float, default=0.10,
+        help="Allowed relative wall time increase per target (default: 0.10)."
+    )
+    run.add_argument(
+        "--size-tolerance", type=float, default=0.05,
+        help="Allowed relative peak RSS and output size increase (default: 0.05)."
+    )
+    run.set_defaults(run=_run_command)
+
+    args = parser.parse_args()
+    results = args.run(args)
+    if args.json:
+        json.dump(results, sys.stdout, indent=2)
+        print()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,69 @@
+import hashlib
+import json
+import os
+from typing import Any, Dict, List, Optional
+
+# Bump when the stored model or digest scheme changes
+DECL_CACHE_VERSION = 5
+
+
+class DeclCache:
+    """
+    Per-declaration results from the previous run, used by --incremental.
+
+    Each entry is keyed by a stable declaration key (USR for functions, file
+    and name for macros) and holds the digest of the declaration's source and
+    of the type mappings it depends on, the resolved model as a dict, and the
+    Nature text generated for it. Entries not looked up again are dropped on
+    save, so deleted declarations do not linger.
+    """
+
+    def __init__(self, path: str):
+        self.path = path
+        self.hits = 0
+        self.misses = 0
+        self._entries: Dict[str, Dict[str, Any]] = {}
+        self._live: Dict[str, Dict[str, Any]] = {}
+        try:
+            with open(path) as f:
+                data = json.load(f)
+            if data.get("version") == DECL_CACHE_VERSION:
+                self._entries = data.get("entries", {})
+        except (OSError, ValueError):
+            pass
+
+    @classmethod
+    def for_header(cls, cache_dir: str, header_path: str, clang_args: List[str]) -> "DeclCache":
+        ident = json.dumps([os.path.abspath(header_path), clang_args])
+        name = hashlib.sha256(ident.encode()).hexdigest()[:32]
+        os.makedirs(cache_dir, exist_ok=True)
+        return cls(os.path.join(cache_dir, f"decls-{name}.json"))
+
+    def lookup(self, key: str, digest: str) -> Optional[Dict[str, Any]]:
+        """Return the cached entry for key if its digest still matches."""
+        entry = self._entries.get(key)
+        if entry is not None and entry.get("digest") == digest:
+            self.hits += 1
+            self._live[key] = entry
+            return entry
+        self.misses += 1
+        return None
+
+    def store(self, key: str, digest: str, model: Optional[Dict[str, Any]]):
+        """Record a freshly computed model; its generated text is filled in later."""
+        self._live[key] = {"digest": digest, "model": model, "text": None}
+
+    def text(self, key: str) -> Optional[str]:
+        entry = self._live.get(key)
+        return entry.get("text") if entry else None
+
+    def set_text(self, key: str, text: str):
+        entry = self._live.get(key)
+        if entry is not None:
+            entry["text"] = text
+
+    def save(self):
+        tmp = f"{self.path}.tmp"
+        with open(tmp, "w") as f:
+            json.dump({"version": DECL_CACHE_VERSION, "entries": self._live}, f, separators=(",", ":"))
+        os.replace(tmp, self.path)
@@ -0,0 +1,16 @@
+from typing import Any
+
+DECL_CACHE_VERSION: int
+
+class DeclCache:
+    path: str
+    hits: int
+    misses: int
+    def __init__(self, path: str) -> None: ...
+    @classmethod
+    def for_header(cls, cache_dir: str, header_path: str, clang_args: list[str]) -> DeclCache: ...
+    def lookup(self, key: str, digest: str) -> dict[str, Any] | None: ...
+    def store(self, key: str, digest: str, model: dict[str, Any] | None) -> None: ...
+    def text(self, key: str) -> str | None: ...
+    def set_text(self, key: str, text: str) -> None: ...
+    def save(self) -> None: ...
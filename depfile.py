@@ -0,0 +1,158 @@
+import filecmp
+import hashlib
+import json
+import os
+from typing import Dict, Iterable, List, Optional
+
+# Bump when the stamp layout changes
+STAMP_VERSION = 2
+
+# Sources whose changes can change the generated text for the same input
+_GENERATOR_SOURCES = ("main.py", "model.py", "layout.py", "split.py", "usage.py", "filters.py", "expr_ast.py",
+                      "out_types.py", "macro_processor.py", "translate.py", "symbols.py", "profiling.py",
+                      "shards.py")
+
+
+def hash_file(path: str) -> Optional[str]:
+    """SHA-256 of a file's contents, or None if it cannot be read."""
+    h = hashlib.sha256()
+    try:
+        with open(path, "rb") as f:
+            for chunk in iter(lambda: f.read(1 << 20), b""):
+                h.update(chunk)
+    except OSError:
+        return None
+    return h.hexdigest()
+
+
+def generator_digest() -> str:
+    """Digest of the generator's own sources, so upgrading it invalidates every stamp."""
+    base = os.path.dirname(os.path.abspath(__file__))
+    h = hashlib.sha256()
+    for name in _GENERATOR_SOURCES:
+        h.update(f"{name}:{hash_file(os.path.join(base, name))}\n".encode())
+    return h.hexdigest()
+
+
+def write_if_changed(path: str, text: str) -> bool:
+    """
+    Write text to path unless the file already holds exactly that text, so
+    consumers keyed on mtime do not rebuild. Returns whether it wrote.
+    """
+    data = text.encode()
+    try:
+        with open(path, "rb") as f:
+            if f.read() == data:
+                return False
+    except OSError:
+        pass
+    tmp = f"{path}.tmp"
+    with open(tmp, "wb") as f:
+        f.write(data)
+    os.replace(tmp, path)
+    return True
+
+
+class ChangedFile:
+    """
+    The streaming form of write_if_changed: a buffered text stream onto
+    path.tmp that replaces path when closed only if it differs from it.
+    written tells whether it did; on an exception path is left alone.
+    """
+
+    def __init__(self, path: str, buffering: int = 1 << 20):
+        self.path = path
+        self.written = False
+        self._tmp = f"{path}.tmp"
+        self._file = open(self._tmp, "w", encoding="utf-8", newline="", buffering=buffering)
+
+    def write(self, text: str) -> int:
+        return self._file.write(text)
+
+    def __enter__(self) -> "ChangedFile":
+        return self
+
+    def __exit__(self, exc_type, exc, tb):
+        self._file.close()
+        if exc_type is not None or (os.path.isfile(self.path) and filecmp.cmp(self._tmp, self.path, shallow=False)):
+            os.remove(self._tmp)
+        else:
+            os.replace(self._tmp, self.path)
+            self.written = True
+
+
+def _make_escape(path: str) -> str:
+    return path.replace("$", "$$").replace("#", "\\#").replace(" ", "\\ ")
+
+
+def format_depfile(target: str, deps: Iterable[str]) -> str:
+    """
+    Makefile rule `target: deps...`, with an empty rule per dependency (like
+    gcc -MP) so a deleted header does not break the next make run.
+    """
+    deps = [_make_escape(dep) for dep in deps]
+    rule = f"{_make_escape(target)}: " + " \\\n  ".join(deps) + "\n"
+    phony = "".join(f"\n{dep}:\n" for dep in deps[1:])
+    return rule + phony
+
+
+def dependencies(header_path: str, include_names: Iterable[str]) -> List[str]:
+    """The header followed by every file it included, absolute and without duplicates."""
+    header = os.path.abspath(header_path)
+    rest = sorted({os.path.abspath(name) for name in include_names} - {header})
+    return [header] + rest
+
+
+class Stamp:
+    """
+    Content hashes recorded next to an output after generating it: the
+    generator, the settings it ran with, every input file and every output.
+    While they all still match, regenerating would produce the same text.
+    """
+
+    def __init__(self, path: str):
+        self.path = path
+
+    @classmethod
+    def for_output(cls, output_path: str) -> "Stamp":
+        return cls(f"{output_path}.stamp")
+
+    def _load(self) -> Optional[Dict]:
+        try:
+            with open(self.path) as f:
+                data = json.load(f)
+        except (OSError, ValueError):
+            return None
+        return data if data.get("version") == STAMP_VERSION else None
+
+    def fresh_dependencies(self, header_path: str, settings: List[str], output_path: str) -> Optional[List[str]]:
+        """
+        The recorded dependencies if nothing that feeds output_path changed
+        since the stamp was written, otherwise None. Only hashes files; never
+        parses.
+        """
+        data = self._load()
+        if data is None or data.get("generator") != generator_digest():
+            return None
+        if data.get("header") != os.path.abspath(header_path) or data.get("settings") != settings:
+            return None
+        outputs: Dict[str, str] = data.get("outputs", {})
+        if os.path.abspath(output_path) not in outputs:
+            return None
+        if any(hash_file(path) != digest for path, digest in outputs.items()):
+            return None
+        deps: Dict[str, str] = data.get("deps", {})
+        if not deps or any(hash_file(path) != digest for path, digest in deps.items()):
+            return None
+        return list(deps)
+
+    def save(self, header_path: str, settings: List[str], output_paths: List[str], deps: List[str]):
+        data = {
+            "version": STAMP_VERSION,
+            "generator": generator_digest(),
+            "header": os.path.abspath(header_path),
+            "settings": settings,
+            "outputs": {os.path.abspath(path): hash_file(path) for path in output_paths},
+            "deps": {path: hash_file(path) for path in deps},
+        }
+        write_if_changed(self.path, json.dumps(data, indent=1) + "\n")
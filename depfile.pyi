@@ -0,0 +1,25 @@
+from typing import Iterable
+
+STAMP_VERSION: int
+
+def hash_file(path: str) -> str | None: ...
+def generator_digest() -> str: ...
+def write_if_changed(path: str, text: str) -> bool: ...
+class ChangedFile:
+    path: str
+    written: bool
+    def __init__(self, path: str, buffering: int = ...) -> None: ...
+    def write(self, text: str) -> int: ...
+    def __enter__(self) -> ChangedFile: ...
+    def __exit__(self, exc_type, exc, tb) -> None: ...
+
+def format_depfile(target: str, deps: Iterable[str]) -> str: ...
+def dependencies(header_path: str, include_names: Iterable[str]) -> list[str]: ...
+
+class Stamp:
+    path: str
+    def __init__(self, path: str) -> None: ...
+    @classmethod
+    def for_output(cls, output_path: str) -> Stamp: ...
+    def fresh_dependencies(self, header_path: str, settings: list[str], output_path: str) -> list[str] | None: ...
+    def save(self, header_path: str, settings: list[str], output_paths: list[str], deps: list[str]): ...
@@ -1,6 +1,11 @@
 from __future__ import annotations
+import ast
+import math
+import re
+import struct
 from dataclasses import dataclass
-from typing import List, Optional, Tuple, Dict, Any
+from decimal import Decimal
+from typing import Callable, Iterable, List, Optional, Tuple, Dict, Any
 
 
 # --- Tokens ---
@@ -11,60 +16,50 @@ class Token:
     text: str
 
 
+_PUNCT_KINDS = {'{': 'brace', '}': 'brace', '(': 'paren', ')': 'paren',
+                '[': 'bracket', ']': 'bracket', ',': 'comma', '=': 'assign'}
+
+
+def _punct_kind(text: str) -> str:
+    return _PUNCT_KINDS.get(text, 'op')
+
+
+# One alternative per token kind, most common first; finditer skips the
+# whitespace between tokens. Numbers follow C's pp-number rule, so exponents
+# (1e-5), hex floats (0x1p-3) and suffixes (10ull, 1.5f) lex as one token and
+# literal_value decides what they mean. Encoding prefixes (u8"", L'') belong
+# to the string or char literal they start.
+_TOKEN_RE = re.compile(r"""
+    (?P<ident>(?!(?:u8|[uUL])["'])[A-Za-z_]\w*)
+  | (?P<number>\.?[0-9](?:[eEpP][+-]|[\w.])*)
+  | (?P<string>(?:u8|[uUL])?"(?:\\.|[^"\\\n])*")
+  | (?P<char>[uUL]?'(?:\\.|[^'\\\n])*')
+  | (?P<punct>\.\.\.|<<=|>>=|->|\+\+|--|<<|>>|<=|>=|==|!=|&&|\|\||\#\#|[-+*/%&|^]=|\S)
+""", re.VERBOSE)
+# Token kind by group number; punctuation is refined by _punct_kind
+_GROUP_KINDS = (None, 'ident', 'number', 'string', 'char', None)
+
+
 def tokenize(src: str) -> List[Token]:
+    return [Token(_GROUP_KINDS[m.lastindex] or _punct_kind(m.group()), m.group())
+            for m in _TOKEN_RE.finditer(src)]
+
+
+def tokens_from_spellings(spellings: Iterable[str]) -> List[Token]:
+    """Classify tokens clang has already split (e.g. from Cursor.get_tokens())."""
     tokens: List[Token] = []
-    i = 0
-    n = len(src)
-    while i < n:
-        ch = src[i]
-        # Skip whitespace
-        if ch.isspace():
-            i += 1
-            continue
-        # Identifiers
-        if ch.isalpha() or ch == '_':
-            start = i
-            i += 1
-            while i < n and (src[i].isalnum() or src[i] == '_'):
-                i += 1
-            tokens.append(Token('ident', src[start:i]))
-            continue
-        # Numbers (very simple, keep spelling)
-        if ch.isdigit():
-            start = i
-            i += 1
-            while i < n and (src[i].isalnum() or src[i] in '.xX'):
-                i += 1
-            tokens.append(Token('number', src[start:i]))
-            continue
-        # Strings
-        if ch == '"':
-            start = i
-            i += 1
-            while i < n:
-                if src[i] == '\\':
-                    i += 2
-                    continue
-                if src[i] == '"':
-                    i += 1
-                    break
-                i += 1
-            tokens.append(Token('string', src[start:i]))
-            continue
-        # Two-char operators
-        if i + 1 < n and src[i:i+2] in ("<<", ">>", "<=", ">=", "==", "!=", "&&", "||"):
-            tokens.append(Token('op', src[i:i+2]))
-            i += 2
-            continue
-        # Single characters
-        if ch in '{}()[],=+-*/%&|^~!<>?:.':
-            kind = 'brace' if ch in '{}' else ('paren' if ch in '()' else ('bracket' if ch in '[]' else ('comma' if ch == ',' else ('assign' if ch == '=' else 'op'))))
-            tokens.append(Token(kind, ch))
-            i += 1
-            continue
-        # Fallback: treat as op
-        tokens.append(Token('op', ch))
-        i += 1
+    for text in spellings:
+        ch = text[0]
+        if ch == '"' or (ch in 'LuU' and text.endswith('"')):
+            tokens.append(Token('string', text))
+        elif ch == "'" or (ch in 'LuU' and text.endswith("'")):
+            tokens.append(Token('char', text))
+        elif ch.isalpha() or ch == '_':
+            tokens.append(Token('ident', text))
+        elif ch.isdigit() or (ch == '.' and len(text) > 1):
+            tokens.append(Token('number', text))
+        else:
+            tokens.append(Token(_punct_kind(text), text))
     return tokens
 
 
@@ -84,6 +79,11 @@ class String(Expr):
 class Identifier(Expr):
     name: str
 
+@dataclass
+class Param(Expr):
+    """A parameter of the function-like macro being parsed."""
+    name: str
+
 @dataclass
 class Unary(Expr):
     op: str
@@ -95,11 +95,28 @@ class Binary(Expr):
     op: str
     right: Expr
 
+@dataclass
+class Cast(Expr):
+    type_name: str  # C spelling, a key of CAST_TYPES
+    expr: Expr
+
 @dataclass
 class Call(Expr):
     func: Identifier
     args: List[Expr]
 
+@dataclass
+class Conditional(Expr):
+    cond: Expr
+    then: Expr
+    other: Expr
+
+@dataclass
+class Member(Expr):
+    expr: Expr
+    field: str
+    arrow: bool  # p->field rather than s.field
+
 @dataclass
 class InitItem:
     field: Optional[str]  # designated field or None
@@ -114,9 +131,10 @@ class CompoundLiteral(Expr):
 # --- Parser ---
 
 class Parser:
-    def __init__(self, tokens: List[Token]):
+    def __init__(self, tokens: List[Token], params: Iterable[str] = ()):
         self.toks = tokens
         self.i = 0
+        self.params = frozenset(params)  # Names parsed as Param (function-like macro bodies)
 
     def _peek(self, k: int = 0) -> Optional[Token]:
         j = self.i + k
@@ -144,6 +162,7 @@ class Parser:
             # (Type){...}
             save = self.i
             self._eat('paren', '(')
+            self._eat('ident', 'struct')
             type_id = self._eat('ident')
             if type_id is not None and self._eat('paren', ')') and self._eat('brace', '{'):
                 items = self._parse_init_list()
@@ -190,7 +209,12 @@ class Parser:
                 ident_tok = self._eat('ident')
                 fld = ident_tok.text if ident_tok is not None else None
                 self._eat('assign', '=')
-            expr = self._parse_expr()
+            if self._eat('brace', '{'):
+                # nested initializer list: {x, y}
+                nested = self._parse_init_list()
+                expr = CompoundLiteral('', nested) if self._eat('brace', '}') else None
+            else:
+                expr = self.parse()
             if expr is None:
                 self.i = save
                 break
@@ -199,97 +223,441 @@ class Parser:
                 break
         return items
 
-    # Very small Pratt parser for +,-,*,/ with parens and calls, identifiers, numbers, strings
+    # Very small Pratt parser with C precedence for binary operators, the
+    # conditional operator, unary operators, parens, calls and member access
+    # over identifiers, numbers and strings
+    _PREC = {
+        '||': 1,
+        '&&': 2,
+        '|': 3,
+        '^': 4,
+        '&': 5,
+        '==': 6, '!=': 6,
+        '<': 7, '>': 7, '<=': 7, '>=': 7,
+        '<<': 8, '>>': 8,
+        '+': 9, '-': 9,
+        '*': 10, '/': 10, '%': 10,
+    }
+    _UNARY = ('-', '+', '~', '!')
+
     def _parse_expr(self, min_prec: int = 0) -> Optional[Expr]:
+        left = self._parse_unary()
+        if left is None:
+            return None
+
+        while True:
+            op_tok = self._peek()
+            if op_tok is None or op_tok.kind != 'op' or op_tok.text not in self._PREC:
+                break
+            prec = self._PREC[op_tok.text]
+            if prec < min_prec:
+                break
+            self._eat()
+            right = self._parse_expr(prec + 1)
+            if right is None:
+                return None
+            left = Binary(left, op_tok.text, right)
+        if min_prec == 0 and self._eat('op', '?'):
+            # Lowest precedence and right associative: a ? b : c ? d : e
+            then = self._parse_expr()
+            if then is None or not self._eat('op', ':'):
+                return None
+            other = self._parse_expr()
+            return Conditional(left, then, other) if other is not None else None
+        return left
+
+    def _parse_unary(self) -> Optional[Expr]:
+        tok = self._peek()
+        if tok is not None and tok.kind == 'op' and tok.text in self._UNARY:
+            self._eat()
+            operand = self._parse_unary()
+            return Unary(tok.text, operand) if operand is not None else None
+        cast_type = self._peek_cast()
+        if cast_type is not None:
+            operand = self._parse_unary()
+            return Cast(cast_type, operand) if operand is not None else None
+        return self._parse_primary()
+
+    def _peek_cast(self) -> Optional[str]:
+        """Consume '(type)' if it names a builtin arithmetic type and return the type."""
+        if not (self._peek() and self._peek().kind == 'paren' and self._peek().text == '('):
+            return None
+        words: List[str] = []
+        j = 1
+        while self._peek(j) is not None and self._peek(j).kind == 'ident':
+            words.append(self._peek(j).text)
+            j += 1
+        close = self._peek(j)
+        type_name = ' '.join(words)
+        if close is None or close.text != ')' or type_name not in CAST_TYPES:
+            return None
+        self.i += j + 1
+        return type_name
+
+    def _parse_primary(self) -> Optional[Expr]:
+        expr = self._parse_atom()
+        while expr is not None:
+            op = self._peek()
+            name = self._peek(1)
+            if op is None or op.text not in ('.', '->') or name is None or name.kind != 'ident':
+                break
+            self.i += 2
+            expr = Member(expr, name.text, op.text == '->')
+        return expr
+
+    def _parse_atom(self) -> Optional[Expr]:
         tok = self._peek()
         if tok is None:
             return None
-        # Primary
-        if tok.kind == 'number':
+        if tok.kind in ('number', 'char'):
             self._eat()
-            left: Expr = Number(tok.text)
-        elif tok.kind == 'string':
+            return Number(tok.text)
+        if tok.kind == 'string':
+            self._eat()
+            return String(tok.text)
+        if tok.kind == 'ident':
+            self._eat()
+            if not self._eat('paren', '('):
+                return Param(tok.text) if tok.text in self.params else Identifier(tok.text)
+            # call
+            args: List[Expr] = []
+            if not self._eat('paren', ')'):
+                while True:
+                    arg = self._parse_expr()
+                    if arg is None:
+                        return None
+                    args.append(arg)
+                    if self._eat('paren', ')'):
+                        break
+                    if not self._eat('comma', ','):
+                        return None
+            return Call(Identifier(tok.text), args)
+        if tok.kind == 'paren' and tok.text == '(':
             self._eat()
-            left = String(tok.text)
-        elif tok.kind == 'ident':
-            ident = self._eat('ident')
-            # call?
-            if self._eat('paren', '('):
-                args: List[Expr] = []
-                if not self._eat('paren', ')'):
-                    while True:
-                        arg = self._parse_expr()
-                        if arg is None:
-                            break
-                        args.append(arg)
-                        if self._eat('paren', ')'):
-                            break
-                        if not self._eat('comma', ','):
-                            break
-                if ident is None:
-                    return None
-                left = Call(Identifier(ident.text), args)
-            else:
-                if ident is None:
-                    return None
-                left = Identifier(ident.text)
-        elif tok.kind == 'paren' and tok.text == '(':
-            self._eat('paren', '(')
             inner = self._parse_expr()
-            self._eat('paren', ')')
-            left = inner if inner else Identifier('')
+            if inner is None or not self._eat('paren', ')'):
+                return None
+            return inner
+        return None
+
+
+# --- Constant folding ---
+
+# Integer types as on LP64 targets: C type -> (conversion rank, bits, signed,
+# Nature type). Rank 0 types only come from casts and are promoted to int
+# before any arithmetic.
+INT_TYPES = {
+    'signed char': (0, 8, True, 'i8'),
+    'unsigned char': (0, 8, False, 'u8'),
+    'short': (0, 16, True, 'i16'),
+    'unsigned short': (0, 16, False, 'u16'),
+    'int': (1, 32, True, 'i32'),
+    'unsigned int': (1, 32, False, 'u32'),
+    'long': (2, 64, True, 'i64'),
+    'unsigned long': (2, 64, False, 'u64'),
+    'long long': (3, 64, True, 'i64'),
+    'unsigned long long': (3, 64, False, 'u64'),
+}
+_FLOAT_TYPES = {'float': 'f32', 'double': 'f64'}
+_NATURE_TO_C = {'i8': 'signed char', 'u8': 'unsigned char', 'i16': 'short', 'u16': 'unsigned short', 'i32': 'int', 'u32': 'unsigned int', 'i64': 'long', 'u64': 'unsigned long',
+                'f32': 'float', 'f64': 'double'}
+
+# Type names accepted in casts: C spelling -> (type after promotion, bits, signed, Nature type)
+CAST_TYPES: Dict[str, Tuple[str, int, bool, str]] = {}
+for _names, _promoted, _bits, _signed, _ntype in [
+    (('char', 'signed char', 'int8_t'), 'int', 8, True, 'i8'),
+    (('unsigned char', 'uint8_t'), 'int', 8, False, 'u8'),
+    (('short', 'short int', 'signed short', 'int16_t'), 'int', 16, True, 'i16'),
+    (('unsigned short', 'unsigned short int', 'uint16_t'), 'int', 16, False, 'u16'),
+    (('int', 'signed', 'signed int', 'int32_t'), 'int', 32, True, 'i32'),
+    (('unsigned', 'unsigned int', 'uint32_t'), 'unsigned int', 32, False, 'u32'),
+    (('long', 'long int', 'signed long', 'int64_t', 'ssize_t', 'ptrdiff_t', 'intptr_t'), 'long', 64, True, 'i64'),
+    (('unsigned long', 'unsigned long int', 'uint64_t', 'size_t', 'uintptr_t'), 'unsigned long', 64, False, 'u64'),
+    (('long long', 'long long int', 'signed long long'), 'long long', 64, True, 'i64'),
+    (('unsigned long long', 'unsigned long long int'), 'unsigned long long', 64, False, 'u64'),
+    (('float',), 'float', 32, True, 'f32'),
+    (('double', 'long double'), 'double', 64, True, 'f64'),
+]:
+    for _name in _names:
+        CAST_TYPES[_name] = (_promoted, _bits, _signed, _ntype)
+
+
+@dataclass(frozen=True)
+class CValue:
+    """A folded constant and its C type (a key of INT_TYPES or 'float'/'double')."""
+    value: int | float
+    ctype: str
+
+
+_INT_LITERAL = re.compile(r'(0[xX][0-9a-fA-F]+|0[bB][01]+|0[0-7]*|[1-9][0-9]*)([uUlL]*)')
+_FLOAT_LITERAL = re.compile(r'((?:\d+\.\d*|\.\d+)(?:[eE][+-]?\d+)?|\d+[eE][+-]?\d+'
+                            r'|0[xX](?:[0-9a-fA-F]*\.[0-9a-fA-F]+|[0-9a-fA-F]+\.?)[pP][+-]?\d+)([fFlL]?)')
+
+# Candidate types for an integer literal, by suffix, in the order C tries them
+_DECIMAL_CANDIDATES = {
+    '': ('int', 'long', 'long long'),
+    'u': ('unsigned int', 'unsigned long', 'unsigned long long'),
+    'l': ('long', 'long long'),
+    'ul': ('unsigned long', 'unsigned long long'),
+    'll': ('long long',),
+    'ull': ('unsigned long long',),
+}
+_OTHER_BASE_CANDIDATES = {
+    '': ('int', 'unsigned int', 'long', 'unsigned long', 'long long', 'unsigned long long'),
+    'u': ('unsigned int', 'unsigned long', 'unsigned long long'),
+    'l': ('long', 'unsigned long', 'long long', 'unsigned long long'),
+    'ul': ('unsigned long', 'unsigned long long'),
+    'll': ('long long', 'unsigned long long'),
+    'ull': ('unsigned long long',),
+}
+
+
+def _fits(value: int, ctype: str) -> bool:
+    _, bits, signed, _ = INT_TYPES[ctype]
+    return -(1 << (bits - 1)) <= value < (1 << (bits - 1)) if signed else 0 <= value < (1 << bits)
+
+
+def _wrap(value: int, ctype: str) -> int:
+    """Reduce value modulo the width of ctype, as C conversions (and wrapping arithmetic) do."""
+    _, bits, signed, _ = INT_TYPES[ctype]
+    value &= (1 << bits) - 1
+    if signed and value >= 1 << (bits - 1):
+        value -= 1 << bits
+    return value
+
+
+def _to_f32(value: float) -> float:
+    return struct.unpack('f', struct.pack('f', value))[0]
+
+
+def literal_value(text: str) -> Optional[CValue]:
+    """Value and C type of an integer, floating or character literal."""
+    m = _INT_LITERAL.fullmatch(text)
+    if m:
+        digits, suffix = m.group(1), m.group(2).lower()
+        suffix = {'lu': 'ul', 'llu': 'ull'}.get(suffix, suffix)
+        decimal = not digits.startswith('0') or digits == '0'
+        candidates = (_DECIMAL_CANDIDATES if decimal else _OTHER_BASE_CANDIDATES).get(suffix)
+        if candidates is None:
+            return None
+        if digits[:2].lower() in ('0x', '0b'):
+            value = int(digits, 0)
+        else:
+            value = int(digits, 8 if len(digits) > 1 and digits[0] == '0' else 10)
+        for ctype in candidates:
+            if _fits(value, ctype):
+                return CValue(value, ctype)
+        return None
+    m = _FLOAT_LITERAL.fullmatch(text)
+    if m:
+        digits, suffix = m.group(1), m.group(2).lower()
+        try:
+            value = float.fromhex(digits) if digits[:2].lower() == '0x' else float(digits)
+            return CValue(_to_f32(value), 'float') if suffix == 'f' else CValue(value, 'double')
+        except (ValueError, OverflowError):
+            return None
+    if text.startswith("'") and text.endswith("'"):
+        try:
+            char = ast.literal_eval(text)
+        except (ValueError, SyntaxError):
+            return None
+        if len(char) != 1 or ord(char) > 0xFF:
+            return None
+        # Plain char is signed, so '\xff' is -1
+        return CValue(ord(char) - 0x100 if ord(char) >= 0x80 else ord(char), 'int')
+    return None
+
+
+def _promoted_type(ctype: str) -> str:
+    """The integer promotions: types narrower than int become int."""
+    return 'int' if ctype in INT_TYPES and INT_TYPES[ctype][0] == 0 else ctype
+
+
+def _promote(v: CValue) -> CValue:
+    return CValue(v.value, _promoted_type(v.ctype))
+
+
+def _common_type(a: str, b: str) -> str:
+    """The usual arithmetic conversions."""
+    a, b = _promoted_type(a), _promoted_type(b)
+    if a in _FLOAT_TYPES or b in _FLOAT_TYPES:
+        return 'double' if 'double' in (a, b) else 'float'
+    if a == b:
+        return a
+    rank_a, _, signed_a, _ = INT_TYPES[a]
+    rank_b, _, signed_b, _ = INT_TYPES[b]
+    if signed_a == signed_b:
+        return a if rank_a >= rank_b else b
+    unsigned, signed = (a, b) if not signed_a else (b, a)
+    if INT_TYPES[unsigned][0] >= INT_TYPES[signed][0]:
+        return unsigned
+    if INT_TYPES[signed][1] > INT_TYPES[unsigned][1]:
+        return signed
+    return 'unsigned ' + signed
+
+
+def _convert(v: CValue, ctype: str) -> int | float:
+    if ctype in _FLOAT_TYPES:
+        value = float(v.value)
+        return _to_f32(value) if ctype == 'float' else value
+    return _wrap(int(v.value), ctype)
+
+
+def _c_div(a: int, b: int) -> int:
+    """Integer division truncating toward zero."""
+    q = abs(a) // abs(b)
+    return q if (a < 0) == (b < 0) else -q
+
+
+def fold(e: Expr, resolve: Callable[[str], Optional[CValue]]) -> Optional[CValue]:
+    """
+    Evaluate an integer or floating constant expression with C semantics, or
+    return None if it is not one. Identifiers are looked up through resolve.
+    """
+    if isinstance(e, Number):
+        return literal_value(e.text)
+    if isinstance(e, Identifier):
+        return resolve(e.name)
+    if isinstance(e, Cast):
+        v = fold(e.expr, resolve)
+        if v is None:
+            return None
+        promoted, bits, signed, _ = CAST_TYPES[e.type_name]
+        if promoted in _FLOAT_TYPES:
+            return CValue(_convert(v, promoted), promoted)
+        if v.ctype in _FLOAT_TYPES:
+            if not math.isfinite(v.value):
+                return None
+            v = CValue(int(v.value), 'long long')
+        # The value keeps the cast's own type, so (unsigned char)300 renders as u8
+        ctype = promoted if bits >= 32 else next(t for t, info in INT_TYPES.items() if info[:3] == (0, bits, signed))
+        return CValue(_wrap(int(v.value), ctype), ctype)
+    if isinstance(e, Unary):
+        v = fold(e.expr, resolve)
+        if v is None:
+            return None
+        v = _promote(v)
+        if e.op == '!':
+            return CValue(int(not v.value), 'int')
+        if e.op == '+':
+            return v
+        if e.op == '-':
+            return CValue(-v.value if v.ctype in _FLOAT_TYPES else _wrap(-v.value, v.ctype), v.ctype)
+        if e.op == '~' and v.ctype in INT_TYPES:
+            return CValue(_wrap(~v.value, v.ctype), v.ctype)
+        return None
+    if isinstance(e, Conditional):
+        cond, then, other = fold(e.cond, resolve), fold(e.then, resolve), fold(e.other, resolve)
+        if cond is None or then is None or other is None:
+            return None
+        ctype = _common_type(then.ctype, other.ctype)
+        return CValue(_convert(then if cond.value else other, ctype), ctype)
+    if isinstance(e, Binary):
+        left = fold(e.left, resolve)
+        right = fold(e.right, resolve)
+        if left is None or right is None:
+            return None
+        left, right = _promote(left), _promote(right)
+        op = e.op
+        if op == '&&':
+            return CValue(int(bool(left.value) and bool(right.value)), 'int')
+        if op == '||':
+            return CValue(int(bool(left.value) or bool(right.value)), 'int')
+        if op in ('<<', '>>'):
+            # The result has the (promoted) type of the left operand
+            if left.ctype not in INT_TYPES or right.ctype not in INT_TYPES:
+                return None
+            if not 0 <= right.value < INT_TYPES[left.ctype][1]:
+                return None
+            result = left.value << right.value if op == '<<' else left.value >> right.value
+            return CValue(_wrap(result, left.ctype), left.ctype)
+        ctype = _common_type(left.ctype, right.ctype)
+        a, b = _convert(left, ctype), _convert(right, ctype)
+        is_float = ctype in _FLOAT_TYPES
+        if op in ('==', '!=', '<', '>', '<=', '>='):
+            result = {'==': a == b, '!=': a != b, '<': a < b, '>': a > b, '<=': a <= b, '>=': a >= b}[op]
+            return CValue(int(result), 'int')
+        if op == '+':
+            value = a + b
+        elif op == '-':
+            value = a - b
+        elif op == '*':
+            value = a * b
+        elif op == '/':
+            if b == 0:
+                return None
+            value = a / b if is_float else _c_div(a, b)
+        elif op == '%' and not is_float:
+            if b == 0:
+                return None
+            value = a - b * _c_div(a, b)
+        elif op in ('&', '|', '^') and not is_float:
+            value = a & b if op == '&' else (a | b if op == '|' else a ^ b)
         else:
             return None
+        if is_float:
+            return CValue(_to_f32(value) if ctype == 'float' else value, ctype)
+        return CValue(_wrap(value, ctype), ctype)
+    return None
 
-        # Binary ops
-        prec_map = {
-            '||': 1,
-            '&&': 2,
-            '==': 3, '!=': 3,
-            '<': 4, '>': 4, '<=': 4, '>=': 4,
-            '+': 5, '-': 5,
-            '*': 6, '/': 6, '%': 6,
-        }
-
-        def get_prec(tok: Optional[Token]) -> int:
-            if tok and tok.kind in ('op',) and tok.text in prec_map:
-                return prec_map[tok.text]
-            return -1
 
-        while True:
-            op_tok = self._peek()
-            prec = get_prec(op_tok)
-            if prec < min_prec:
-                break
-            if op_tok is None:
+def _float_text(value: float, ctype: str) -> str:
+    text = repr(value)
+    if ctype == 'float':
+        # Shortest spelling that reads back as the same f32
+        for digits in range(6, 10):
+            text = f"{value:.{digits}g}"
+            if _to_f32(float(text)) == value:
                 break
-            op = op_tok.text
-            self._eat()
-            right = self._parse_expr(prec + 1)
-            if right is None:
-                break
-            left = Binary(left, op, right)
-        return left
+    if 'e' in text:
+        text = format(Decimal(text), 'f')
+    return text if '.' in text else f"{text}.0"
+
+
+def render_value(v: CValue) -> Optional[Tuple[str, str]]:
+    """Nature type and literal for a folded value."""
+    if v.ctype in _FLOAT_TYPES:
+        if not math.isfinite(v.value):
+            return None
+        return (_FLOAT_TYPES[v.ctype], _float_text(v.value, v.ctype))
+    return (INT_TYPES[v.ctype][3], str(v.value))
+
+
+def value_of_constant(ntype: str, text: str) -> Optional[CValue]:
+    """Recover the folded value of a constant emitted as a plain literal (e.g. a cached one)."""
+    ctype = _NATURE_TO_C.get(ntype)
+    if ctype is None:
+        return None
+    try:
+        return CValue(float(text), ctype) if ctype in _FLOAT_TYPES else CValue(int(text), ctype)
+    except ValueError:
+        return None
 
 
 # --- Rendering to Nature ---
 
 def _strip_float_suffix(num: str) -> str:
-    # remove trailing f/F if present
+    # remove trailing f/F if present (hex digits are not suffixes)
+    if num[:2].lower() == '0x':
+        return num
     if num.lower().endswith('f') and (len(num) == 1 or num[-2].isdigit() or num[-2] == '.'): 
         return num[:-1]
     return num
 
 def _expr_contains_float(e: Expr) -> bool:
     if isinstance(e, Number):
-        t = e.text
-        return ('f' in t.lower()) or ('.' in t) or ('e' in t.lower())
+        t = e.text.lower()
+        if t.startswith('0x'):
+            return 'p' in t
+        return t.endswith('f') or '.' in t or 'e' in t
     if isinstance(e, String):
         return False
     if isinstance(e, Identifier):
         return False
     if isinstance(e, Unary):
         return _expr_contains_float(e.expr)
+    if isinstance(e, Cast):
+        return CAST_TYPES[e.type_name][0] in _FLOAT_TYPES
     if isinstance(e, Binary):
         return _expr_contains_float(e.left) or _expr_contains_float(e.right)
     if isinstance(e, Call):
@@ -306,7 +674,10 @@ def render_expr(e: Expr) -> str:
     if isinstance(e, Identifier):
         return e.name
     if isinstance(e, Unary):
-        return f"{e.op}{render_expr(e.expr)}"
+        inner = render_expr(e.expr)
+        return f"{e.op}({inner})" if isinstance(e.expr, Unary) else f"{e.op}{inner}"
+    if isinstance(e, Cast):
+        return f"({render_expr(e.expr)} as {CAST_TYPES[e.type_name][3]})"
     if isinstance(e, Binary):
         left = render_expr(e.left)
         right = render_expr(e.right)
@@ -333,9 +704,11 @@ def render_constant(e: Expr, structs: Dict[str, Any], unions: Dict[str, Any]) ->
         return ("anyptr", render_expr(e))
 
     # Numbers or arithmetic
-    if isinstance(e, (Number, Unary, Binary)):
+    if isinstance(e, (Number, Unary, Binary, Cast)):
         ctype = 'f32' if _expr_contains_float(e) else 'i32'
-        return (ctype, render_expr(e))
+        value = render_expr(e)
+        # The outermost parens of a binary expression are redundant
+        return (ctype, value[1:-1] if isinstance(e, Binary) else value)
 
     # Compound literal mapped through struct info
     if isinstance(e, CompoundLiteral):
@@ -363,9 +736,32 @@ def render_constant(e: Expr, structs: Dict[str, Any], unions: Dict[str, Any]) ->
     return None
 
 
+def has_call(e: Expr) -> bool:
+    """Whether e invokes anything (function-like macros, casts through calls, ...)."""
+    if isinstance(e, Call):
+        return True
+    if isinstance(e, (Unary, Cast, Member)):
+        return has_call(e.expr)
+    if isinstance(e, Binary):
+        return has_call(e.left) or has_call(e.right)
+    if isinstance(e, Conditional):
+        return has_call(e.cond) or has_call(e.then) or has_call(e.other)
+    return False
+
+
 def parse_macro_replacement(text: str) -> Optional[Expr]:
     toks = tokenize(text)
     p = Parser(toks)
     return p.parse()
 
 
+def parse_macro_tokens(tokens: List[Token], params: Iterable[str] = ()) -> Optional[Expr]:
+    """
+    Parse an already tokenized macro replacement (or C expression); None
+    unless every token is consumed. Identifiers in params parse as Param.
+    """
+    p = Parser(tokens, params)
+    expr = p.parse()
+    return expr if expr is not None and p.i == len(tokens) else None
+
+
@@ -1,6 +1,6 @@
 from _typeshed import Incomplete
 from dataclasses import dataclass
-from typing import Any
+from typing import Any, Callable, Iterable
 
 @dataclass
 class Token:
@@ -8,6 +8,7 @@ class Token:
     text: str
 
 def tokenize(src: str) -> list[Token]: ...
+def tokens_from_spellings(spellings: Iterable[str]) -> list[Token]: ...
 
 class Expr: ...
 
@@ -23,6 +24,10 @@ class String(Expr):
 class Identifier(Expr):
     name: str
 
+@dataclass
+class Param(Expr):
+    name: str
+
 @dataclass
 class Unary(Expr):
     op: str
@@ -34,11 +39,28 @@ class Binary(Expr):
     op: str
     right: Expr
 
+@dataclass
+class Cast(Expr):
+    type_name: str
+    expr: Expr
+
 @dataclass
 class Call(Expr):
     func: Identifier
     args: list[Expr]
 
+@dataclass
+class Conditional(Expr):
+    cond: Expr
+    then: Expr
+    other: Expr
+
+@dataclass
+class Member(Expr):
+    expr: Expr
+    field: str
+    arrow: bool
+
 @dataclass
 class InitItem:
     field: str | None
@@ -52,9 +74,24 @@ class CompoundLiteral(Expr):
 class Parser:
     toks: Incomplete
     i: int
-    def __init__(self, tokens: list[Token]) -> None: ...
+    params: frozenset[str]
+    def __init__(self, tokens: list[Token], params: Iterable[str] = ()) -> None: ...
     def parse(self) -> Expr | None: ...
 
+INT_TYPES: dict[str, tuple[int, int, bool, str]]
+CAST_TYPES: dict[str, tuple[str, int, bool, str]]
+
+@dataclass(frozen=True)
+class CValue:
+    value: int | float
+    ctype: str
+
+def literal_value(text: str) -> CValue | None: ...
+def fold(e: Expr, resolve: Callable[[str], CValue | None]) -> CValue | None: ...
+def render_value(v: CValue) -> tuple[str, str] | None: ...
+def value_of_constant(ntype: str, text: str) -> CValue | None: ...
 def render_expr(e: Expr) -> str: ...
 def render_constant(e: Expr, structs: dict[str, Any], unions: dict[str, Any]) -> tuple[str, str] | None: ...
+def has_call(e: Expr) -> bool: ...
 def parse_macro_replacement(text: str) -> Expr | None: ...
+def parse_macro_tokens(tokens: list[Token], params: Iterable[str] = ()) -> Expr | None: ...
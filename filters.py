@@ -0,0 +1,91 @@
+import dataclasses
+import fnmatch
+import os
+import re
+from typing import Any, Dict, List, Optional
+
+# Option / manifest key for each rule list
+RULE_KEYS = ("allow", "deny", "allow_prefix", "deny_prefix", "allow_file", "deny_file")
+
+
+@dataclasses.dataclass
+class DeclFilter:
+    """
+    Which declarations (functions, records, enums, typedefs, macros) to bind.
+
+    Names are matched against allow/deny regexes (the whole name must match)
+    and prefixes, source files against globs (tried on the full path and on
+    the base name). With any allow rule present a declaration must match one
+    of them; a deny rule always wins. Types used by kept declarations are
+    pulled in by the generator even when no allow rule names them, but never
+    when denied.
+    """
+    allow: List[str] = dataclasses.field(default_factory=list)
+    deny: List[str] = dataclasses.field(default_factory=list)
+    allow_prefix: List[str] = dataclasses.field(default_factory=list)
+    deny_prefix: List[str] = dataclasses.field(default_factory=list)
+    allow_file: List[str] = dataclasses.field(default_factory=list)
+    deny_file: List[str] = dataclasses.field(default_factory=list)
+
+    def __post_init__(self):
+        self._allow_re = self._compile(self.allow)
+        self._deny_re = self._compile(self.deny)
+        self._allow_prefix = tuple(self.allow_prefix)
+        self._deny_prefix = tuple(self.deny_prefix)
+        self._file_rules: Dict[str, tuple[bool, bool]] = {}  # File -> (allowed, denied)
+
+    @staticmethod
+    def _compile(patterns: List[str]) -> Optional[re.Pattern]:
+        return re.compile("|".join(f"(?:{p})" for p in patterns)) if patterns else None
+
+    @classmethod
+    def from_rules(cls, rules: Dict[str, Any]) -> Optional["DeclFilter"]:
+        """A filter from a mapping of RULE_KEYS to lists, or None when it has no rules."""
+        lists = {key: list(rules.get(key) or []) for key in RULE_KEYS}
+        return cls(**lists) if any(lists.values()) else None
+
+    def merged(self, other: Optional["DeclFilter"]) -> "DeclFilter":
+        if other is None:
+            return self
+        return DeclFilter(**{key: getattr(self, key) + getattr(other, key) for key in RULE_KEYS})
+
+    @property
+    def has_allow_rules(self) -> bool:
+        return bool(self.allow or self.allow_prefix or self.allow_file)
+
+    def settings(self) -> List[str]:
+        """The rules as flat strings, for stamps that must change with them."""
+        return [f"{key}={value}" for key in RULE_KEYS for value in getattr(self, key)]
+
+    def _file(self, file_name: str) -> tuple[bool, bool]:
+        rules = self._file_rules.get(file_name)
+        if rules is None:
+            base = os.path.basename(file_name)
+            match = lambda globs: any(fnmatch.fnmatch(file_name, g) or fnmatch.fnmatch(base, g) for g in globs)
+            rules = (match(self.allow_file), match(self.deny_file))
+            self._file_rules[file_name] = rules
+        return rules
+
+    def file_denied(self, file_name: str) -> bool:
+        """Whether nothing from file_name may be bound; the walk skips such files outright."""
+        return bool(self.deny_file) and self._file(file_name)[1]
+
+    def denies(self, name: str, file_name: str = "") -> bool:
+        if self._deny_re is not None and self._deny_re.fullmatch(name):
+            return True
+        if self._deny_prefix and name.startswith(self._deny_prefix):
+            return True
+        return self.file_denied(file_name) if file_name else False
+
+    def allows(self, name: str, file_name: str = "") -> bool:
+        """Whether an allow rule selects the declaration (always true without allow rules)."""
+        if not self.has_allow_rules:
+            return True
+        if self._allow_re is not None and self._allow_re.fullmatch(name):
+            return True
+        if self._allow_prefix and name.startswith(self._allow_prefix):
+            return True
+        return bool(file_name) and self._file(file_name)[0]
+
+    def keeps(self, name: str, file_name: str = "") -> bool:
+        return self.allows(name, file_name) and not self.denies(name, file_name)
@@ -0,0 +1,23 @@
+from typing import Any
+
+RULE_KEYS: tuple[str, ...]
+
+class DeclFilter:
+    allow: list[str]
+    deny: list[str]
+    allow_prefix: list[str]
+    deny_prefix: list[str]
+    allow_file: list[str]
+    deny_file: list[str]
+    def __post_init__(self) -> None: ...
+    @classmethod
+    def from_rules(cls, rules: dict[str, Any]) -> DeclFilter | None: ...
+    def merged(self, other: DeclFilter | None) -> DeclFilter: ...
+    @property
+    def has_allow_rules(self) -> bool: ...
+    def settings(self) -> list[str]: ...
+    def file_denied(self, file_name: str) -> bool: ...
+    def denies(self, name: str, file_name: str = '') -> bool: ...
+    def allows(self, name: str, file_name: str = '') -> bool: ...
+    def keeps(self, name: str, file_name: str = '') -> bool: ...
+    def __init__(self, allow: list[str] = ..., deny: list[str] = ..., allow_prefix: list[str] = ..., deny_prefix: list[str] = ..., allow_file: list[str] = ..., deny_file: list[str] = ...) -> None: ...
@@ -0,0 +1,143 @@
+import logging
+import os
+import sys
+import time
+from contextlib import contextmanager
+from typing import Dict, Iterator, List, Optional
+
+try:
+    import resource
+except ImportError:  # Not available on Windows
+    resource = None
+
+# Shared by every module. Disabled levels cost one isEnabledFor check: messages
+# use %-style arguments, and call sites whose arguments need libclang calls are
+# guarded with log.isEnabledFor(logging.DEBUG).
+log = logging.getLogger("naturebindgen")
+
+LOG_LEVELS = ("debug", "info", "warning", "error")
+
+
+class _Formatter(logging.Formatter):
+    """Plain progress lines at INFO, 'LEVEL: message' for everything else."""
+
+    def format(self, record: logging.LogRecord) -> str:
+        message = record.getMessage()
+        if record.levelno == logging.INFO:
+            return message
+        return f"{record.levelname}: {message}"
+
+
+def configure_logging(level: str = "info"):
+    """Send log output to stderr at the given level name."""
+    handler = logging.StreamHandler(sys.stderr)
+    handler.setFormatter(_Formatter())
+    log.handlers[:] = [handler]
+    log.propagate = False
+    log.setLevel(getattr(logging, level.upper()))
+
+
+def peak_rss_kib() -> Optional[int]:
+    """Peak resident set size of this process in KiB, if the platform reports it."""
+    if resource is None:
+        return None
+    peak = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+    # ru_maxrss is in bytes on macOS and KiB elsewhere
+    return peak // 1024 if sys.platform == "darwin" else peak
+
+
+def current_rss_kib() -> Optional[int]:
+    """Resident set size of this process right now in KiB (Linux only)."""
+    try:
+        with open("/proc/self/statm") as f:
+            resident_pages = int(f.read().split()[1])
+    except (OSError, ValueError, IndexError):
+        return None
+    return resident_pages * (os.sysconf("SC_PAGE_SIZE") // 1024)
+
+
+class Timings:
+    """
+    Per-phase wall time and event counters for --timings.
+
+    Phases are entered a handful of times per run (never per cursor), so they
+    are always measured, along with the resident set size each one leaves
+    behind; counters are plain dict increments.
+    """
+
+    def __init__(self):
+        self.phases: Dict[str, List[float]] = {}  # name -> [seconds, entries]
+        self.rss_after: Dict[str, Optional[int]] = {}  # name -> RSS in KiB when it last ended
+        self.counters: Dict[str, int] = {}
+
+    def reset(self):
+        self.phases.clear()
+        self.rss_after.clear()
+        self.counters.clear()
+
+    @contextmanager
+    def phase(self, name: str) -> Iterator[None]:
+        start = time.perf_counter()
+        try:
+            yield
+        finally:
+            entry = self.phases.setdefault(name, [0.0, 0])
+            entry[0] += time.perf_counter() - start
+            entry[1] += 1
+            self.rss_after[name] = current_rss_kib()
+
+    def count(self, name: str, n: int = 1):
+        self.counters[name] = self.counters.get(name, 0) + n
+
+    def snapshot(self) -> Dict[str, object]:
+        """Phase seconds, counters and peak RSS as plain data (for bench.py's JSON)."""
+        return {
+            "phases": {name: seconds for name, (seconds, _) in self.phases.items()},
+            "counters": dict(self.counters),
+            "rss_after_kib": dict(self.rss_after),
+            "peak_rss_kib": peak_rss_kib(),
+        }
+
+    def report(self, title: str = "Timings") -> str:
+        lines = [f"--- {title} ---"]
+        total = sum(seconds for seconds, _ in self.phases.values())
+        for name, (seconds, entries) in self.phases.items():
+            share = (seconds / total * 100) if total else 0.0
+            rss = self.rss_after.get(name)
+            memory = f"  {rss / 1024:8.1f} MiB after" if rss is not None else ""
+            lines.append(f"{name:<24} {seconds * 1000:10.1f} ms {share:5.1f}%  x{entries}{memory}")
+        lines.append(f"{'total':<24} {total * 1000:10.1f} ms")
+        if self.counters:
+            lines.append("Counts:")
+            for name in sorted(self.counters):
+                lines.append(f"  {name:<22} {self.counters[name]}")
+        peak = peak_rss_kib()
+        if peak is not None:
+            lines.append(f"Peak RSS: {peak / 1024:.1f} MiB")
+        return "\n".join(lines)
+
+
+# Process-wide instance; each worker process gets its own
+timings = Timings()
+
+
+def count_libclang_calls() -> Dict[str, int]:
+    """
+    Route every libclang function clang.cindex has registered through a
+    counter and return the live name -> calls table. The wrappers add Python
+    call overhead to each call, so only measurement runs should install them.
+    """
+    from clang.cindex import conf
+    lib = conf.lib
+    calls: Dict[str, int] = {}
+
+    def counted(name, func):
+        def wrapper(*args):
+            calls[name] = calls.get(name, 0) + 1
+            return func(*args)
+        return wrapper
+
+    for name, func in list(vars(lib).items()):
+        if name.startswith("clang_") and callable(func):
+            setattr(lib, name, counted(name, func))
+    return calls
@@ -0,0 +1,26 @@
+import logging
+from collections.abc import Iterator
+from contextlib import contextmanager
+
+log: logging.Logger
+LOG_LEVELS: tuple[str, ...]
+
+def configure_logging(level: str = 'info') -> None: ...
+def peak_rss_kib() -> int | None: ...
+def current_rss_kib() -> int | None: ...
+
+class Timings:
+    phases: dict[str, list[float]]
+    rss_after: dict[str, int | None]
+    counters: dict[str, int]
+    def __init__(self) -> None: ...
+    def reset(self) -> None: ...
+    @contextmanager
+    def phase(self, name: str) -> Iterator[None]: ...
+    def count(self, name: str, n: int = 1) -> None: ...
+    def snapshot(self) -> dict[str, object]: ...
+    def report(self, title: str = 'Timings') -> str: ...
+
+timings: Timings
+
+def count_libclang_calls() -> dict[str, int]: ...
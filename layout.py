@@ -0,0 +1,212 @@
+"""
+Struct layouts that match C byte for byte. Nature places each field at the
+next multiple of its alignment and pads the struct to its widest field, like
+a C compiler without attributes. Where the layout libclang recorded differs
+(explicit alignment, packing, bitfields) the plan adds padding fields, or
+stores fields as raw bytes that generated accessors read and write in place.
+"""
+import dataclasses
+import re
+from typing import Callable, Dict, List, Optional
+
+from out_types import Struct, StructField
+
+
+@dataclasses.dataclass(slots=True)
+class Slot:
+    """One emitted field of a struct."""
+    name: str
+    ntype: str
+    offset: int  # Byte offset, equal to C's
+    kind: str = "field"  # field, pad, bytes (a misaligned field) or bits (bitfield storage)
+    fields: List[StructField] = dataclasses.field(default_factory=list)  # The C fields bytes/bits stand for
+
+
+_PRIMITIVE_ALIGN = {"bool": 1, "i8": 1, "u8": 1, "i16": 2, "u16": 2, "i32": 4, "u32": 4, "f32": 4,
+                    "i64": 8, "u64": 8, "f64": 8, "int": 8, "uint": 8, "float": 8, "anyptr": 8, "string": 8}
+_ARRAY_RE = re.compile(r"\[(.+);\s*\d+\]")
+
+
+def _align_up(n: int, align: int) -> int:
+    return (n + align - 1) // align * align
+
+
+class Alignments:
+    """
+    Nature's alignment of a field type, as plan_layout needs it: primitives,
+    pointers and arrays align like in C, but a struct aligns to its widest
+    emitted slot, so one planned with bytes or bits slots aligns to 1
+    whatever C says. Unknown types give None.
+    """
+
+    def __init__(self, structs: Dict[str, Struct], unions: Dict[str, int]):
+        self._structs = structs  # Name -> struct, as emitted
+        self._unions = unions  # Union storage type name -> alignment of its element
+        self._cache: Dict[str, Optional[int]] = {}
+
+    def __call__(self, ntype: str) -> Optional[int]:
+        if ntype in self._cache:
+            return self._cache[ntype]
+        self._cache[ntype] = None  # A record holding itself by value cannot be laid out anyway
+        align = _PRIMITIVE_ALIGN.get(ntype)
+        array = _ARRAY_RE.fullmatch(ntype)
+        if align is not None:
+            pass
+        elif ntype.startswith(("rawptr<", "ptr<", "fn(")):
+            align = 8
+        elif array:
+            align = self(array[1].strip())
+        elif ntype in self._unions:
+            align = self._unions[ntype]
+        elif ntype in self._structs:
+            align = struct_alignment(self._structs[ntype], self)
+        self._cache[ntype] = align
+        return align
+
+
+def struct_alignment(struct: Struct, align_of: Callable[[str], Optional[int]]) -> Optional[int]:
+    """Nature's alignment of struct as emitted by plan_layout, or None if a field type is unknown."""
+    slots = plan_layout(struct, align_of)
+    if slots is None:
+        aligns = [align_of(f.ntype) for f in struct.fields]
+    else:
+        aligns = [align_of(slot.ntype) if slot.kind == "field" else 1 for slot in slots]
+    return None if None in aligns else max(aligns, default=1)
+
+
+def plan_layout(struct: Struct, align_of: Optional[Callable[[str], Optional[int]]] = None) -> Optional[List[Slot]]:
+    """
+    The fields to emit for struct so its Nature layout equals the C one, or
+    None when the layout was not recorded (incomplete records, flexible
+    array members, models from before offsets were kept) and the fields are
+    best emitted as declared. align_of (see Alignments) tells where Nature
+    will place a field; a field whose Nature alignment it does not know is
+    always preceded by explicit padding.
+    """
+    if struct.size is None or any(f.offset is None or (f.size is None and f.bit_width is None) for f in struct.fields):
+        return None
+    limit = struct.align or 1
+    slots: List[Slot] = []
+    cur = widest = 0
+
+    def pad_to(offset: int):
+        if offset > cur:
+            slots.append(Slot(f"_pad_{cur}", f"[u8;{offset - cur}]", cur, "pad"))
+
+    fields = struct.fields
+    i = 0
+    while i < len(fields):
+        f = fields[i]
+        if f.bit_width is not None:
+            # Consecutive bitfields share one run of bytes
+            run = []
+            while i < len(fields) and fields[i].bit_width is not None:
+                if fields[i].bit_width:
+                    run.append(fields[i])
+                i += 1
+            if not run:
+                continue
+            start = run[0].offset // 8
+            end = max((b.offset + b.bit_width + 7) // 8 for b in run)
+            if start < cur:
+                return None
+            pad_to(start)
+            slots.append(Slot(f"_bits_{start}", f"[u8;{end - start}]", start, "bits", run))
+            cur = end
+            widest = max(widest, 1)
+            continue
+        i += 1
+        offset, align = f.offset // 8, f.align or 1
+        nature_align = align_of(f.ntype) if align_of is not None else None
+        if f.offset % 8 or offset < cur:
+            return None
+        if offset % align or align > limit or (nature_align and offset % nature_align):
+            # Packed: Nature would realign it, so keep the bytes and reach them through accessors
+            pad_to(offset)
+            slots.append(Slot(f.name, f"[u8;{f.size}]", offset, "bytes", [f]))
+            widest = max(widest, 1)
+        else:
+            if nature_align is None or _align_up(cur, nature_align) != offset:
+                pad_to(offset)
+            slots.append(Slot(f.name, f.ntype, offset, "field", [f]))
+            widest = max(widest, nature_align or align)
+        cur = offset + f.size
+    if _align_up(cur, max(widest, 1)) != struct.size:
+        pad_to(struct.size)
+    return slots
+
+
+def _is_signed(ntype: str) -> bool:
+    return ntype in ("i8", "i16", "i32", "i64", "int")
+
+
+def accessors(struct_name: str, slot: Slot, qualify=str) -> List[str]:
+    """get/set functions for the C fields behind a bytes or bits slot."""
+    lines: List[str] = []
+    ptr = f"rawptr<{struct_name}> s"
+    if slot.kind == "bytes":
+        f = slot.fields[0]
+        ntype = qualify(f.ntype)
+        at = f"(((s as anyptr) + {slot.offset}) as rawptr<{ntype}>)"
+        lines += [
+            f"fn {struct_name}_get_{f.name}({ptr}):{ntype} {{",
+            f"    return *{at}",
+            "}",
+            f"fn {struct_name}_set_{f.name}({ptr}, {ntype} value) {{",
+            f"    *{at} = value",
+            "}",
+        ]
+    elif slot.kind == "bits":
+        for f in slot.fields:
+            first, last = f.offset // 8, (f.offset + f.bit_width - 1) // 8
+            if not f.name or last - first >= 8:
+                continue  # Unnamed padding bits, or wider than one load
+            shift, width = f.offset - first * 8, f.bit_width
+            base = f"(s as anyptr) + {first}" if first else "s as anyptr"
+            mask = f"0x{(1 << width) - 1:x}"
+            load = " | ".join(f"(((*((p + {k}) as rawptr<u8>)) as u64) << {8 * k})" if k else "((*(p as rawptr<u8>)) as u64)"
+                              for k in range(last - first + 1))
+            if f.ntype == "bool":
+                get = f"((bits >> {shift}) & 1) != 0"
+                value = "v"
+            elif _is_signed(f.ntype):
+                get = f"(((bits << {64 - shift - width}) as i64) >> {64 - width}) as {f.ntype}"
+                value = "(value as u64)"
+            else:
+                get = f"((bits >> {shift}) & {mask}) as {f.ntype}"
+                value = "(value as u64)"
+            lines += [
+                f"fn {struct_name}_get_{f.name}({ptr}):{f.ntype} {{",
+                f"    anyptr p = {base}",
+                f"    u64 bits = {load}",
+                f"    return {get}",
+                "}",
+                f"fn {struct_name}_set_{f.name}({ptr}, {f.ntype} value) {{",
+                f"    anyptr p = {base}",
+                f"    u64 bits = {load}",
+            ]
+            if f.ntype == "bool":
+                lines += ["    u64 v = 0", "    if value {", "        v = 1", "    }"]
+            lines.append(f"    bits = (bits & ~({mask} << {shift})) | (({value} & {mask}) << {shift})")
+            lines += [f"    *((p + {k}) as rawptr<u8>) = (bits >> {8 * k}) as u8" if k else "    *(p as rawptr<u8>) = bits as u8"
+                      for k in range(last - first + 1)]
+            lines.append("}")
+    return lines
+
+
+def size_check(name: str, records: List[tuple[str, int]]) -> str:
+    """
+    A Nature function comparing @sizeof of every record with the C sizeof
+    recorded at generation time; it prints each mismatch and returns false
+    if there was any.
+    """
+    lines = ["// Layout self-check against the C sizes", f"fn {name}():bool {{", "    bool ok = true"]
+    for record, size in records:
+        lines += [
+            f"    if @sizeof({record}) != {size} {{",
+            f"        println('{record}: ', @sizeof({record}), ' bytes in Nature, {size} in C')",
+            "        ok = false",
+            "    }",
+        ]
+    lines += ["    return ok", "}"]
+    return "\n".join(lines)
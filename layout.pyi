@@ -0,0 +1,20 @@
+from dataclasses import dataclass, field
+from out_types import Struct, StructField
+from typing import Callable
+
+@dataclass(slots=True)
+class Slot:
+    name: str
+    ntype: str
+    offset: int
+    kind: str = ...
+    fields: list[StructField] = field(default_factory=list)
+
+class Alignments:
+    def __init__(self, structs: dict[str, Struct], unions: dict[str, int]) -> None: ...
+    def __call__(self, ntype: str) -> int | None: ...
+
+def struct_alignment(struct: Struct, align_of: Callable[[str], int | None]) -> int | None: ...
+def plan_layout(struct: Struct, align_of: Callable[[str], int | None] | None = None) -> list[Slot] | None: ...
+def accessors(struct_name: str, slot: Slot, qualify=...) -> list[str]: ...
+def size_check(name: str, records: list[tuple[str, int]]) -> str: ...
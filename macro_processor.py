@@ -1,11 +1,31 @@
-from typing import Optional, List, Dict, Any
+import contextlib
+import logging
+import re
+import tempfile
+from concurrent.futures import ProcessPoolExecutor
+from concurrent.futures.process import BrokenProcessPool
+from typing import Optional, List, Dict, Any, Set
 from expr_ast import parse_macro_replacement, render_constant
-from clang.cindex import Index, TranslationUnit, CursorKind, TypeKind
+from instrument import configure_logging, log, timings
+from clang.cindex import Index, TranslationUnit, TranslationUnitLoadError, CursorKind, TypeKind
+
+# Fewest macros worth a worker process of their own
+MIN_SHARD = 64
 
 class MacroProcessor:
-    def __init__(self, structs: Dict[str, Any], unions: Dict[str, Any]):
+    def __init__(self, structs: Dict[str, Any], unions: Dict[str, Any], tu_cache: Optional[Any] = None):
         self.structs = structs
         self.unions = unions
+        self.tu_cache = tu_cache  # Optional TUCache supplying per-header PCHs
+        # (cache dir, header, args) -> PCH path, or None when it could not be built or was
+        # rejected; looked up once per processor (one generator run) and reused by every parse
+        self._pch_paths: Dict[tuple, Optional[str]] = {}
+
+    def _macro_pch(self, tu_cache: Any, header_path: str, base_args: List[str]) -> Optional[str]:
+        key = (tu_cache.cache_dir, header_path, tuple(base_args))
+        if key not in self._pch_paths:
+            self._pch_paths[key] = tu_cache.macro_pch(header_path, base_args)
+        return self._pch_paths[key]
 
     def _map_c_type_to_nature(self, c_type) -> str:
         """Lightweight C type to Nature type mapping for macros."""
@@ -121,33 +141,129 @@ class MacroProcessor:
             return " ".join(t.spelling for t in tokens)
         return "<unknown>"
 
+    @staticmethod
+    def _eval_args(header_path: str, clang_args: Optional[List[str]]) -> List[str]:
+        """Arguments evaluation TUs (and the PCH they include) are parsed with."""
+        # -ferror-limit=0 keeps one bad macro from hiding the rest of a batch
+        base_args = ['-std=c11', '-ferror-limit=0'] + (clang_args or [])
+
+        # Add include path for the header's directory
+        if '/' in header_path:
+            header_dir = header_path.rsplit('/', 1)[0]
+            base_args.append(f'-I{header_dir}')
+        return base_args
+
+    def _parse_eval_tu(self, header_path: str, body_lines: List[str], clang_args: Optional[List[str]], use_pch: bool = True):
+        """
+        Parse a synthetic evaluation TU whose first line brings in header_path
+        (through a cached PCH when available) followed by body_lines.
+        """
+        index = Index.create()
+        base_args = self._eval_args(header_path, clang_args)
+        pch = self._macro_pch(self.tu_cache, header_path, base_args) if self.tu_cache and use_pch else None
+        if pch:
+            # The cache validates the PCH by content hash, so clang's mtime check is redundant
+            prelude = f'// evaluated against precompiled {header_path}'
+            args = ['-x', 'c'] + base_args + ['-include-pch', pch, '-Xclang', '-fno-validate-pch']
+        else:
+            prelude = f'#include "{header_path}"'
+            args = ['-x', 'c'] + base_args
+        code = "\n".join([prelude] + body_lines) + "\n"
+        log.debug("Generated code:\n%s", code)
+
+        log.debug("MacroProcessor.parse args: %s", args)
+        timings.count("clang macro parses")
+        try:
+            tu = index.parse('tmp.c', args=args, unsaved_files=[('tmp.c', code)])
+        except TranslationUnitLoadError as e:
+            log.debug("Failed to parse translation unit: %s", e)
+            tu = None
+
+        if pch and (not tu or any(d.severity >= d.Fatal for d in tu.diagnostics)):
+            # A PCH clang refuses is worse than none; drop it and parse against the header
+            log.debug("PCH for %s rejected, falling back to #include", header_path)
+            self.tu_cache.invalidate("pch", header_path, base_args)
+            self._pch_paths[(self.tu_cache.cache_dir, header_path, tuple(base_args))] = None
+            return self._parse_eval_tu(header_path, body_lines, clang_args, use_pch=False)
+        return tu
+
+    def _result_from_var(self, cursor, define_name: str) -> Optional[str]:
+        """Turn an evaluated dummy VAR_DECL into '<type> <name> = <value>;'."""
+        if log.isEnabledFor(logging.DEBUG):
+            log.debug("Found dummy var for %s: type='%s'", define_name, cursor.type.spelling if cursor.type else None)
+
+        if not cursor.type:
+            log.debug("No type information for macro value")
+            return None
+
+        type_name = self._map_c_type_to_nature(cursor.type)
+
+        if not type_name:
+            log.debug("Could not determine type for %s", define_name)
+            return None
+
+        # Reconstruct RHS text from tokens for robust parsing
+        tok_list = list(cursor.get_tokens())
+        if log.isEnabledFor(logging.DEBUG):
+            log.debug("VAR_DECL tokens: %s", [t.spelling for t in tok_list])
+        eq_index = -1
+        for i, t in enumerate(tok_list):
+            if t.spelling == '=':
+                eq_index = i
+                break
+        rhs_text = ''
+        if eq_index != -1:
+            expr_tokens = tok_list[eq_index + 1:]
+            if expr_tokens and expr_tokens[-1].spelling == ';':
+                expr_tokens = expr_tokens[:-1]
+            rhs_text = ''.join(t.spelling for t in expr_tokens).strip()
+        # If there's no RHS at all (header guards etc.), skip
+        if not rhs_text:
+            return None
+
+        # Prefer AST child initializer if present
+        children = list(cursor.get_children())
+        if children:
+            value = self._expr_to_str(children[0])
+            log.debug("Initializer child expr -> '%s' from kind=%s", value, children[0].kind)
+        else:
+            value = rhs_text
+            log.debug("Initializer from RHS text -> '%s'", value)
+
+        # Try robust parsing via lightweight AST
+        expr = parse_macro_replacement(rhs_text)
+        if expr is not None:
+            rendered = render_constant(expr, self.structs, self.unions)
+            if rendered is not None:
+                type_name, value = rendered
+
+        # Normalize string literal to Nature pointer form
+        if isinstance(value, str) and value.startswith('"') and value.endswith('"'):
+            value = f'{value}.ref()'
+            type_name = 'anyptr'
+
+        # If the value looks like Struct{...}, ensure type_name matches
+        if isinstance(value, str):
+            m3 = re.match(r"^(\w+)\s*\{", value)
+            if m3 and m3.group(1) in self.structs:
+                type_name = m3.group(1)
+
+        return f"{type_name} {define_name} = {value};"
+
     def process_macro(self, header_path: str, define_name: str, clang_args: Optional[List[str]] = None) -> Optional[str]:
         """Process a macro definition using Python-side type information."""
         # Skip system headers
         if header_path.startswith('<') and header_path.endswith('>'):
-            print(f"DEBUG: Skipping system header: {header_path}")
+            log.debug("Skipping system header: %s", header_path)
             return None
 
         # Generate code to evaluate the macro
-        code = (
-            f'#include "{header_path}"\n'
-            f'static const __typeof__({define_name}) __dummy_var = {define_name};\n'
+        tu = self._parse_eval_tu(
+            header_path,
+            [f'static const __typeof__({define_name}) __dummy_var = {define_name};'],
+            clang_args
         )
-        print(f"DEBUG: Generated code:\n{code}")
-
-        # Parse the code
-        index = Index.create()
-        args = ['-x', 'c', '-std=c11'] + (clang_args or [])
-        
-        # Add include path for the header's directory
-        if '/' in header_path:
-            header_dir = header_path.rsplit('/', 1)[0]
-            args.append(f'-I{header_dir}')
-
-        print(f"DEBUG: MacroProcessor.parse args: {args}")
-        tu = index.parse('tmp.c', args=args, unsaved_files=[('tmp.c', code)])
         if not tu:
-            print("DEBUG: Failed to parse translation unit")
             return None
 
         # Find our dummy variable
@@ -156,64 +272,143 @@ class MacroProcessor:
                 cursor.spelling == '__dummy_var' and 
                 cursor.location.file and 
                 str(cursor.location.file) == 'tmp.c'):
-                print(f"DEBUG: Found __dummy_var: type='{cursor.type.spelling if cursor.type else None}'")
-                
-                if not cursor.type:
-                    print("DEBUG: No type information for macro value")
-                    return None
-
-                type_name = self._map_c_type_to_nature(cursor.type)
-
-                if not type_name:
-                    print(f"DEBUG: Could not determine type for {define_name}")
-                    return None
-
-                # Reconstruct RHS text from tokens for robust parsing
-                tok_list = list(cursor.get_tokens())
-                print(f"DEBUG: VAR_DECL tokens: {[t.spelling for t in tok_list]}")
-                eq_index = -1
-                for i, t in enumerate(tok_list):
-                    if t.spelling == '=':
-                        eq_index = i
-                        break
-                rhs_text = ''
-                if eq_index != -1:
-                    expr_tokens = tok_list[eq_index + 1:]
-                    if expr_tokens and expr_tokens[-1].spelling == ';':
-                        expr_tokens = expr_tokens[:-1]
-                    rhs_text = ''.join(t.spelling for t in expr_tokens).strip()
-                # If there's no RHS at all (header guards etc.), skip
-                if not rhs_text:
-                    return None
-
-                # Prefer AST child initializer if present
-                children = list(cursor.get_children())
-                if children:
-                    value = self._expr_to_str(children[0])
-                    print(f"DEBUG: Initializer child expr -> '{value}' from kind={children[0].kind}")
-                else:
-                    value = rhs_text
-                    print(f"DEBUG: Initializer from RHS text -> '{value}'")
-
-                # Try robust parsing via lightweight AST
-                expr = parse_macro_replacement(rhs_text)
-                if expr is not None:
-                    rendered = render_constant(expr, self.structs, self.unions)
-                    if rendered is not None:
-                        type_name, value = rendered
-
-                # Normalize string literal to Nature pointer form
-                if isinstance(value, str) and value.startswith('"') and value.endswith('"'):
-                    value = f'{value}.ref()'
-                    type_name = 'anyptr'
-
-                # If the value looks like Struct{...}, ensure type_name matches
-                if isinstance(value, str):
-                    m3 = _re.match(r"^(\w+)\s*\{", value)
-                    if m3 and m3.group(1) in self.structs:
-                        type_name = m3.group(1)
-
-                return f"{type_name} {define_name} = {value};"
-
-        print("DEBUG: Could not find macro value")
+                return self._result_from_var(cursor, define_name)
+
+        log.debug("Could not find macro value")
         return None
+
+    def process_macros(self, header_path: str, define_names: List[str], clang_args: Optional[List[str]] = None,
+                       jobs: int = 1) -> Dict[str, Optional[str]]:
+        """
+        Evaluate many macros from one header with a single clang parse, or
+        with jobs > 1 one parse per worker process over consecutive shards
+        of define_names.
+
+        Returns a mapping of macro name to the same '<type> <name> = <value>;'
+        string process_macro produces (or None when it could not be evaluated).
+        """
+        results: Dict[str, Optional[str]] = {name: None for name in define_names}
+        if not define_names:
+            return results
+        # Skip system headers
+        if header_path.startswith('<') and header_path.endswith('>'):
+            log.debug("Skipping system header: %s", header_path)
+            return results
+
+        shards = min(jobs, len(define_names) // MIN_SHARD)
+        if shards > 1:
+            try:
+                self._evaluate_sharded(header_path, list(define_names), clang_args, shards, results)
+                return results
+            except (BrokenProcessPool, OSError) as e:
+                log.warning("Parallel macro evaluation failed (%s), evaluating serially", e)
+        self._evaluate_batch(header_path, list(define_names), clang_args, results)
+        return results
+
+    def _evaluate_sharded(self, header_path: str, define_names: List[str], clang_args: Optional[List[str]],
+                          shards: int, results: Dict[str, Optional[str]]):
+        """
+        Evaluate consecutive shards of define_names in worker processes. Each
+        macro's result does not depend on its batch (failures are retried
+        alone either way), so results equal a serial run's.
+        """
+        with contextlib.ExitStack() as stack:
+            tu_cache = self.tu_cache
+            if tu_cache is None:
+                # Without --cache-dir the PCH lives only as long as this evaluation
+                from tu_cache import TUCache
+                tu_cache = TUCache(stack.enter_context(tempfile.TemporaryDirectory(prefix="naturebindgen-pch-")))
+            # Built once here so every worker includes it instead of parsing the header again;
+            # if it cannot be built, workers include the header rather than all retrying
+            pch = self._macro_pch(tu_cache, header_path, self._eval_args(header_path, clang_args))
+            size = -(-len(define_names) // shards)
+            chunks = [define_names[i:i + size] for i in range(0, len(define_names), size)]
+            log.debug("Evaluating %s macros from %s in %s shards", len(define_names), header_path, len(chunks))
+            level = logging.getLevelName(log.getEffectiveLevel()).lower()
+            with ProcessPoolExecutor(max_workers=len(chunks), initializer=_init_worker,
+                                     initargs=(self.structs, self.unions, tu_cache.cache_dir if pch else None, level)) as pool:
+                # map yields in submission order, whatever order the shards finish in
+                for shard_results, parses in pool.map(_evaluate_shard, [header_path] * len(chunks), chunks,
+                                                      [clang_args] * len(chunks)):
+                    results.update(shard_results)
+                    timings.count("clang macro parses", parses)
+
+    def _evaluate_batch(self, header_path: str, define_names: List[str], clang_args: Optional[List[str]], results: Dict[str, Optional[str]]):
+        if len(define_names) == 1:
+            results[define_names[0]] = self.process_macro(header_path, define_names[0], clang_args)
+            return
+
+        # One dummy variable per macro, one per line so diagnostics map back to a macro
+        lines: List[str] = []
+        var_to_name: Dict[str, str] = {}
+        for i, name in enumerate(define_names):
+            var_name = f'__dummy_var_{i}'
+            var_to_name[var_name] = name
+            lines.append(f'static const __typeof__({name}) {var_name} = {name};')
+        log.debug("Evaluating batch of %s macros from %s", len(define_names), header_path)
+
+        tu = self._parse_eval_tu(header_path, lines, clang_args)
+        if not tu:
+            self._bisect_batch(header_path, define_names, clang_args, results)
+            return
+
+        error_lines: Set[int] = set()
+        for diag in tu.diagnostics:
+            if diag.severity < diag.Error:
+                continue
+            in_tmp = diag.location.file and str(diag.location.file) == 'tmp.c'
+            if not in_tmp or diag.location.line <= 1:
+                # The header itself is broken; evaluating macros one by one will not do better
+                if diag.severity >= diag.Fatal:
+                    log.debug("Fatal error outside macro batch: %s", diag.spelling)
+                    return
+                continue
+            error_lines.add(diag.location.line)
+
+        resolved: Set[str] = set()
+        for cursor in tu.cursor.get_children():
+            if cursor.kind != CursorKind.VAR_DECL or cursor.spelling not in var_to_name:
+                continue
+            if not cursor.location.file or str(cursor.location.file) != 'tmp.c':
+                continue
+            if cursor.location.line in error_lines:
+                continue
+            name = var_to_name[cursor.spelling]
+            results[name] = self._result_from_var(cursor, name)
+            resolved.add(name)
+
+        # A macro erroring on its own line fails alone too, so it keeps its None result;
+        # only those that vanished (e.g. swallowed by a neighbour's bad expansion) are
+        # retried. Macro i is on line i + 2, after the prelude. One pass, in order, as
+        # batches can hold thousands of macros
+        failed = [n for i, n in enumerate(define_names) if n not in resolved and i + 2 not in error_lines]
+        if not failed:
+            return
+        log.debug("%s of %s macros failed in batch, retrying", len(failed), len(define_names))
+        if len(failed) < len(define_names):
+            self._evaluate_batch(header_path, failed, clang_args, results)
+        else:
+            self._bisect_batch(header_path, define_names, clang_args, results)
+
+    def _bisect_batch(self, header_path: str, define_names: List[str], clang_args: Optional[List[str]], results: Dict[str, Optional[str]]):
+        mid = len(define_names) // 2
+        self._evaluate_batch(header_path, define_names[:mid], clang_args, results)
+        self._evaluate_batch(header_path, define_names[mid:], clang_args, results)
+
+
+# --- Worker processes for MacroProcessor._evaluate_sharded ---
+
+_worker: Optional[MacroProcessor] = None
+
+
+def _init_worker(structs: Dict[str, Any], unions: Dict[str, Any], cache_dir: Optional[str], log_level: str):
+    global _worker
+    from tu_cache import TUCache
+    configure_logging(log_level)
+    _worker = MacroProcessor(structs, unions, tu_cache=TUCache(cache_dir) if cache_dir else None)
+
+
+def _evaluate_shard(header_path: str, define_names: List[str], clang_args: Optional[List[str]]):
+    timings.reset()
+    results = _worker.process_macros(header_path, define_names, clang_args)
+    return results, timings.counters.get("clang macro parses", 0)
@@ -2,8 +2,12 @@ from _typeshed import Incomplete
 from clang.cindex import TranslationUnit as TranslationUnit
 from typing import Any
 
+MIN_SHARD: int
+
 class MacroProcessor:
     structs: Incomplete
     unions: Incomplete
-    def __init__(self, structs: dict[str, Any], unions: dict[str, Any]) -> None: ...
+    tu_cache: Incomplete
+    def __init__(self, structs: dict[str, Any], unions: dict[str, Any], tu_cache: Any | None = None) -> None: ...
     def process_macro(self, header_path: str, define_name: str, clang_args: list[str] | None = None) -> str | None: ...
+    def process_macros(self, header_path: str, define_names: list[str], clang_args: list[str] | None = None, jobs: int = 1) -> dict[str, str | None]: ...
@@ -1,5 +1,8 @@
 #!/usr/bin/env python3
 import argparse
+import dataclasses
+import hashlib
+import logging
 import os
 import re
 import sys
@@ -9,8 +12,8 @@ from typing import Dict, List, Optional, Set
 
 # Ensure libclang and num2words are installed:
 # pip install libclang num2words
-from clang.cindex import (Config, Cursor, CursorKind, Index, TranslationUnit,
-                          Type, TypeKind)
+from clang.cindex import (Config, Cursor, CursorKind, Index, StorageClass,
+                          TranslationUnit, Type, TypeKind)
 
 if os.name == "posix":
     Config.set_library_file("/usr/lib/libclang.so")
@@ -19,101 +22,133 @@ else:
 
 from out_types import (
     Constant, Parameter, Function, StructField, Struct,
-    Union, EnumMember, Enum, UnnamedObject
+    Union, EnumMember, Enum, UnnamedObject, HeaderGuard
 )
+from tu_cache import TUCache
+from decl_cache import DeclCache
+from filters import DeclFilter
+from model import STDOUT, BindingModel, EmitOptions, overload_spec, prune_to_sources, write_bindings
+from depfile import Stamp, dependencies, format_depfile, write_if_changed
+from translate import Statement, Translator, Untranslatable
+from symbols import Library, SymbolIndex, update_package_toml, verify_exports
+from shards import Shard, ShardMerger, umbrella_shards
+from expr_ast import (CompoundLiteral, CValue, Expr, Identifier, String, fold,
+                      has_call, parse_macro_tokens, render_constant, render_expr,
+                      render_value, tokens_from_spellings, value_of_constant)
+from instrument import LOG_LEVELS, configure_logging, log, timings
+
+# Kinds whose children can hold further bindable declarations. Everything else
+# (function bodies and parameters, enum constants, expressions, macros) is a leaf
+# for the walk; handlers read what they need from those cursors directly.
+_DESCEND_KINDS = frozenset({
+    CursorKind.TRANSLATION_UNIT, CursorKind.STRUCT_DECL, CursorKind.UNION_DECL,
+    CursorKind.TYPEDEF_DECL, CursorKind.FIELD_DECL, CursorKind.VAR_DECL,
+    CursorKind.UNEXPOSED_DECL, CursorKind.LINKAGE_SPEC,
+})
+_RECORD_KINDS = frozenset({CursorKind.STRUCT_DECL, CursorKind.UNION_DECL})
+# Declarations a DeclFilter can drop; types among them are parked instead so a
+# kept declaration that uses one can still pull it in
+_TYPE_KINDS = _RECORD_KINDS | {CursorKind.ENUM_DECL, CursorKind.TYPEDEF_DECL}
+_FILTERED_KINDS = _TYPE_KINDS | {CursorKind.FUNCTION_DECL}
+
+
+def union_type_name(size: int) -> str:
+    """Union_eight_bytes; sizes like 24 or 128 spell with hyphens and spaces, which are not identifiers."""
+    return f"Union_{re.sub(r'[^A-Za-z0-9]+', '_', num2words(size))}_bytes"
 
 # --- Core Binding Generator ---
 
-class BindingGenerator:
+class BindingGenerator(BindingModel):
     """
     Generates Nature language bindings from C header files by parsing the AST
-    using libclang.
+    using libclang. Emission lives in BindingModel.
     """
 
-    def __init__(self):
-        self.structs: Dict[str, Struct] = {}
-        self.unions: Dict[str, Union] = {}
-        self.enums: Dict[str, Enum] = {}
-        self.functions: Dict[str, Function] = {}
-        self.constants: Dict[str, Constant] = {}
-        self.typedefs: Dict[str, str] = {}
-        self.union_sizes: Dict[str, int] = {}  # Maps union names to their sizes
-        self.clang_to_contextual: Dict[UnnamedObject, str] = {}  # Maps raw clang spelling to contextual names
-
-        self._processed_cursors: Set[Cursor] = set()
-        self._anon_type_map: Dict[str, str] = {} # Maps Clang anonymous names to our generated ones
-        self._queued_macros: List[tuple[Cursor, str, List[str], bool]] = []
+    def __init__(self, tu_cache: Optional[TUCache] = None, decl_cache: Optional[DeclCache] = None,
+                 decl_filter: Optional[DeclFilter] = None, macro_jobs: int = 1):
+        super().__init__()
+        self.tu_cache = tu_cache  # Reuses parsed TUs and macro PCHs across runs when set
+        self.decl_cache = decl_cache  # Per-declaration results from the last run (--incremental)
+        self.decl_filter = decl_filter  # Declarations to bind; everything when None
+        # Part of every declaration digest: what a cached result pulled in depends on the rules
+        self._filter_stamp = "\0".join(decl_filter.settings()) if decl_filter else ""
+        self.macro_jobs = macro_jobs  # Worker processes for clang macro evaluation
+        # Sharded umbrella parsing (see shards.py): files other shards bind, whose macros
+        # are only handled when referenced, and (kind, name) -> USR for the merge
+        self.shard_files: Set[str] = set()
+        self.decl_usrs: Optional[Dict[tuple[str, str], str]] = None
+        self._shard_file_cache: Dict[str, bool] = {}
+
+        self._seen_usrs: Set[str] = set()  # Dedupes cursors reachable along several paths
+        self._file_allowed_cache: Dict[str, bool] = {}
+        # Fields whose anonymous record type was not named yet when the field was created
+        self._unresolved_fields: List[tuple[StructField, Type, UnnamedObject]] = []
+        self._queued_macros: List[tuple[Cursor, str, List[str]]] = []
+        # Filtered out but still handled if a kept macro refers to them
+        self._filtered_macros: Dict[str, tuple[Cursor, str, List[str]]] = {}
+        self._deferred_types: Dict[str, Cursor] = {}  # USR -> type declaration the filter parked
+        self._wanted_usrs: Set[str] = set()  # Types used before the walk reached them
+        self._first_macro_by_file: Dict[str, str] = {}  # File -> name of the first macro it defines
+        self._header_guards: Dict[str, HeaderGuard] = {}  # File -> include guard info, built once per parse
+        # Incremental mode bookkeeping
+        self._source_cache: Dict[str, bytes] = {}  # File -> contents, for extent digests
+        self._macro_tokens: Dict[str, List[str]] = {}  # Macro name -> token spellings, name first
+        self._queued_by_name: Dict[str, tuple[Cursor, str, List[str]]] = {}  # For out-of-order folding
+        self._macro_files: Dict[str, str] = {}  # Macro name -> defining file, for Constant.file
+        self._handled_macros: Set[str] = set()
+        self._enum_values: Dict[str, int] = {}  # Enum member -> value, for folding
+        self._macro_cache_keys: Dict[str, tuple[str, str]] = {}  # Macro name -> (cache key, digest) to store
+        # Macros needing clang evaluation, keyed by name: (header, clang args, fallback constant)
+        self._pending_macro_evals: Dict[str, tuple[str, List[str], Optional[Constant]]] = {}
+        # Header code to translate once the model is complete (see translate.py)
+        self._function_macros: Dict[str, tuple[List[str], List[str], str]] = {}  # Name -> (params, body, file)
+        # Static function -> (C parameter names, body statements or None, cache key, digest)
+        self._inline_bodies: Dict[str, tuple[List[str], Optional[List[Statement]], Optional[str], Optional[str]]] = {}
+        self.translated: List[str] = []  # Macros and static inline functions emitted as Nature code
+        self.untranslated: Dict[str, str] = {}  # Name -> why it could not be translated
 
         self.reserved_keywords: Set[str] = {"type", "ptr"}
+        # (kind, spelling, canonical spelling, declaration USR, const, volatile) -> mapped
+        # type; cleared when a typedef, union alias or anonymous record name changes
+        self._type_map_cache: Dict[tuple, str] = {}
 
         self._initialize_type_mappings()
 
-    def _parse_unnamed_object(self, spelling: str) -> Optional[UnnamedObject]:
-        """Parse clang spelling to extract unnamed object information."""
-        if not spelling or ("unnamed" not in spelling and "anonymous" not in spelling):
-            print(f"DEBUG: Failed to parse unnamed object: {spelling}")
-            return None
-
-        # Handle patterns like:
-        # "struct (unnamed at test_edge_cases.h:31:5)"
-        # "union (unnamed at test_edge_cases.h:57:5)"
-        # "(unnamed struct at test_edge_cases.h:31:5)"
-        # "(unnamed union at test_edge_cases.h:57:5)"
-
-        is_union = "union" in spelling
-        is_struct = "struct" in spelling
-
-        # Extract file and location
-        match = re.search(r'at ([^:]+):(\d+):(\d+)', spelling)
-        if match:
-            file = match.group(1)
-            location = f"{match.group(2)}:{match.group(3)}"
-            return UnnamedObject(is_union=is_union, file=file, location=location)
-
-        print(f"DEBUG: Failed to parse unnamed object: {spelling}")
-        return None
+    def _is_anonymous_record(self, cursor: Cursor) -> bool:
+        spelling = cursor.spelling
+        return not spelling or "anonymous" in spelling or "unnamed" in spelling
 
-    def _get_unnamed_object_mapping(self, type_spelling: str) -> Optional[str]:
-        """
-        Gets the contextual name for an unnamed/anonymous object from our mapping.
-        
-        Args:
-            type_spelling: The raw type spelling from clang that might contain unnamed/anonymous references
-            
-        Returns:
-            The mapped contextual name if found, otherwise None
-        """
-        if not type_spelling or ("unnamed" not in type_spelling and "anonymous" not in type_spelling):
+    def _record_key(self, cursor: Cursor) -> Optional[UnnamedObject]:
+        """Identity of an anonymous record declaration: its kind and where it is defined."""
+        location = cursor.location
+        if location.file is None:
             return None
-
-        # Try direct mapping first
-        if type_spelling in self.clang_to_contextual:
-            unnamed_obj = self._parse_unnamed_object(type_spelling)
-            if unnamed_obj:
-                return self.clang_to_contextual[unnamed_obj]
-
-        # Try parsing as UnnamedObject and find matching mapping
-        unnamed_obj = self._parse_unnamed_object(type_spelling)
-        if unnamed_obj:
-            # Look for a mapping that matches this unnamed object
-            for clang_spelling, contextual_name in self.clang_to_contextual.items():
-                if isinstance(clang_spelling, UnnamedObject):  # Ensure we're comparing UnnamedObjects
-                    if (clang_spelling.is_union == unnamed_obj.is_union and
-                        clang_spelling.file == unnamed_obj.file and
-                        clang_spelling.location == unnamed_obj.location):
-                        return contextual_name
-
-        # Check for struct/union prefix
-        if type_spelling.startswith("struct "):
-            result = self._get_unnamed_object_mapping(type_spelling[7:])
-            if result:
-                return result
-        elif type_spelling.startswith("union "):
-            result = self._get_unnamed_object_mapping(type_spelling[6:])
-            if result:
-                return result
-
-        return None
+        return UnnamedObject(is_union=cursor.kind == CursorKind.UNION_DECL,
+                             file=location.file.name,
+                             location=f"{location.line}:{location.column}")
+
+    def _decl_file(self, cursor: Cursor) -> Optional[str]:
+        location_file = cursor.location.file
+        return location_file.name if location_file else None
+
+    def _fallback_record_name(self, cursor: Cursor, prefix: str) -> str:
+        """Name of an anonymous record with no naming context: where it is defined, the same in every TU."""
+        location = cursor.location
+        if location.file is None:
+            return f"Anonymous_{prefix}"
+        stem = re.sub(r"\W", "_", os.path.splitext(os.path.basename(location.file.name))[0])
+        return f"Anonymous_{prefix}_{stem}_{location.line}_{location.column}"
+
+    def _note_usr(self, kind: str, name: str, cursor: Cursor):
+        if self.decl_usrs is not None:
+            usr = cursor.get_usr()
+            if usr:
+                self.decl_usrs[(kind, name)] = usr
+
+    def _anonymous_record_name(self, decl: Cursor) -> Optional[str]:
+        """Contextual name given to an anonymous record, if it has been visited yet."""
+        key = self._record_key(decl)
+        return self.clang_to_contextual.get(key) if key is not None else None
 
     def _initialize_type_mappings(self):
         """Sets up the default C to Nature type mappings."""
@@ -143,8 +178,34 @@ class BindingGenerator:
         """Appends an underscore to a name if it's a reserved keyword."""
         return f"{name}_" if name in self.reserved_keywords else name
 
+    def _invalidate_type_map(self):
+        """Forget memoized type mappings after typedefs, union aliases or anonymous names change."""
+        if self._type_map_cache:
+            self._type_map_cache.clear()
+            timings.count("type map invalidations")
+
     def _map_c_type_to_nature(self, c_type: Type) -> str:
+        """Converts a clang Type object to a Nature language type string, memoized."""
+        # The spelling as written decides typedef and pointer names; the
+        # canonical type and the declaration's USR tell apart different types
+        # spelled alike (a typedef redeclared in another header or shard), and
+        # the qualifiers are keyed explicitly rather than trusted to the spelling
+        decl = c_type.get_declaration()  # None (a null cursor) for builtin types
+        key = (c_type.kind, c_type.spelling, c_type.get_canonical().spelling, decl.get_usr() if decl else "",
+               c_type.is_const_qualified(), c_type.is_volatile_qualified())
+        mapped = self._type_map_cache.get(key)
+        if mapped is not None:
+            timings.count("type map hits")
+            return mapped
+        timings.count("type map misses")
+        mapped = self._type_map_cache[key] = sys.intern(self._map_uncached_type(c_type))
+        return mapped
+
+    def _map_uncached_type(self, c_type: Type) -> str:
         """Converts a clang Type object to a Nature language type string."""
+        # `struct Foo` / typedef names written in source; map what they name
+        if c_type.kind == TypeKind.ELABORATED:
+            c_type = c_type.get_named_type()
         type_spelling = c_type.spelling.replace("const ", "").strip()
 
         # 1. Handle Pointers
@@ -160,9 +221,12 @@ class BindingGenerator:
 
             # For known record types, return a typed raw pointer
             pointee_decl = pointee.get_declaration()
-            if pointee_decl.kind in (CursorKind.STRUCT_DECL, CursorKind.UNION_DECL):
-                # Use the canonical name if it's an anonymous type we've mapped
-                record_name = self._anon_type_map.get(pointee_decl.spelling, pointee_decl.spelling)
+            if pointee_decl.kind in _RECORD_KINDS:
+                self._require(pointee_decl)
+                record_name = pointee_decl.spelling
+                # Use the contextual name if it's an anonymous type we've mapped
+                if self._is_anonymous_record(pointee_decl):
+                    record_name = self._anonymous_record_name(pointee_decl) or record_name
                 return f"rawptr<{record_name}>"
 
             return "anyptr" # Default for other pointers
@@ -175,30 +239,33 @@ class BindingGenerator:
 
         # 3. Handle Typedefs
         if c_type.kind == TypeKind.TYPEDEF:
+            self._require(c_type.get_declaration())
             return self.typedefs.get(type_spelling, type_spelling)
 
         # 4. Handle Structs and Unions
         if c_type.kind == TypeKind.RECORD:
             decl = c_type.get_declaration()
+            self._require(decl)
             record_name = decl.spelling
-            print(f"DEBUG: Record type found: '{record_name}' (kind: {c_type.kind})")
+            log.debug("Record type found: '%s' (kind: %s)", record_name, c_type.kind)
 
             # Check if this is an anonymous type we've processed
-            if "anonymous" in record_name or "unnamed" in record_name or not record_name:
-                print(f"DEBUG: Anonymous type found: '{record_name}'")
-                # Try to get the contextual name from our mapping
-                contextual_name = self._get_unnamed_object_mapping(record_name)
+            if self._is_anonymous_record(decl):
+                contextual_name = self._anonymous_record_name(decl)
                 if contextual_name:
-                    print(f"DEBUG: Mapped '{record_name}' to '{contextual_name}'")
+                    log.debug("Mapped '%s' to '%s'", record_name, contextual_name)
                     return contextual_name
-                # Fallback to anon type map
-                return self._anon_type_map.get(record_name, record_name)
+                # Not visited yet; _resolve_anonymous_fields fixes fields up after the walk
+                return record_name
 
             # Remove "struct" prefix if present
             if record_name.startswith("struct "):
                 record_name = record_name[7:]  # Remove "struct " prefix
             return record_name
 
+        if c_type.kind == TypeKind.ENUM:
+            self._require(c_type.get_declaration())
+
         # 5. Basic Types from our map
         # Use canonical type for robustness (e.g., `long int` -> `long`)
         canonical_spelling = c_type.get_canonical().spelling.replace("const ", "").strip()
@@ -218,7 +285,7 @@ class BindingGenerator:
         # 8. Check if this is a union name we've seen
         if normalized_type in self.union_sizes:
             size = self.union_sizes[normalized_type]
-            return f"Union_{num2words(size)}_bytes"
+            return union_type_name(size)
 
         # 9. Check if this is a known struct
         if normalized_type in self.structs:
@@ -233,133 +300,396 @@ class BindingGenerator:
 
         return "any" # Last resort
 
-    def parse_header(self, header_path: str, c_args: List[str] | None = None):
-        """Parses the given C header file and populates the binding model."""
+    def parse_header(self, header_path: str, c_args: List[str] | None = None) -> TranslationUnit:
+        """Parses the given C header file, populates the binding model and returns the TU."""
+        tu = self.parse_translation_unit(header_path, c_args)
+        self.collect(tu, header_path, c_args)
+        return tu
+
+    def parse_translation_unit(self, header_path: str, c_args: List[str] | None = None,
+                               index: Optional[Index] = None) -> TranslationUnit:
+        """
+        Parses header_path with libclang, through tu_cache when set. A
+        long-lived index can be passed in to be reused across parses.
+        """
         if not os.path.exists(header_path):
             raise FileNotFoundError(f"Header file not found: {header_path}")
 
-        print(f"Parsing header: {header_path}")
-        index = Index.create()
+        log.info("Parsing header: %s", header_path)
+        index = index or Index.create()
         # Use '-x', 'c-header' to force parsing as C
         # Add -fparse-all-comments to ensure we get macro definitions
         args = ['-x', 'c-header', '-fparse-all-comments', '-dD']  # -dD preserves macro definitions
         if c_args:
             args.extend(c_args)
-        print(f"DEBUG: Parsing with args: {args}")
-        tu = index.parse(header_path, args=args, 
-                        options=TranslationUnit.PARSE_DETAILED_PROCESSING_RECORD | 
-                                TranslationUnit.PARSE_INCLUDE_BRIEF_COMMENTS_IN_CODE_COMPLETION)
+        log.debug("Parsing with args: %s", args)
+        options = (TranslationUnit.PARSE_DETAILED_PROCESSING_RECORD |
+                   TranslationUnit.PARSE_INCLUDE_BRIEF_COMMENTS_IN_CODE_COMPLETION)
+        with timings.phase("clang parse"):
+            if self.tu_cache:
+                tu = self.tu_cache.parse(index, header_path, args, options)
+            else:
+                tu = index.parse(header_path, args=args, options=options)
 
         if not tu:
             raise RuntimeError("Failed to parse the translation unit.")
+        return tu
 
+    def collect(self, tu: TranslationUnit, header_path: str, c_args: List[str] | None = None):
+        """Populates the binding model from a translation unit of header_path."""
+        self.header = os.path.abspath(header_path)
         has_errors = any(diag.severity >= diag.Error for diag in tu.diagnostics)
         if has_errors:
-            print("Clang errors encountered during parsing. Bindings may be incomplete.", file=sys.stderr)
+            log.warning("Clang errors encountered during parsing. Bindings may be incomplete.")
 
-        self._visit_cursor(tu.cursor, header_path, c_args or [], is_root=True)
+        with timings.phase("ast walk"):
+            self._visit_cursor(tu.cursor, header_path, c_args or [])
 
-        # Post-process: fix field types using our contextual mappings
-        self._fix_field_types()
+        # Macros run after types so struct info is available
+        with timings.phase("macro fast path"):
+            self._flush_queued_macros()
+        with timings.phase("macro fallback"):
+            pending = len(self._pending_macro_evals)
+            self._evaluate_pending_macros()
+            self._store_macro_cache_entries()
+            timings.count("macros evaluated by clang", pending)
 
-        # Fix field types by mapping anonymous/unnamed types
-        self._map_anonymous_field_types()
+        with timings.phase("post-processing"):
+            # Name fields whose anonymous record type was visited after them
+            self._resolve_anonymous_fields()
 
-        # Final adjustments to constants (e.g., struct compound literals)
-        self._postprocess_constants()
+            # Final adjustments to constants (e.g., struct compound literals)
+            self._postprocess_constants()
+            for const in self.constants.values():
+                const.file = const.file or self._macro_files.get(const.name) or None
 
-    def _visit_cursor(self, cursor: Cursor, header_path: str = "", clang_args: Optional[List[str]] = None, is_root: bool = False):
-        """Recursively traverses the AST and dispatches to handlers."""
-        if not cursor or (cursor.location.file and "usr/include" in str(cursor.location.file)):
-            return
-        if cursor in self._processed_cursors:
-            return
-        self._processed_cursors.add(cursor)
+        with timings.phase("translation"):
+            self._translate_header_code()
 
-        kind = cursor.kind
-        print(f"DEBUG: Visiting cursor: {cursor.spelling} (kind: {kind})")
+        self._release_clang_objects()
 
+    def _release_clang_objects(self):
+        """
+        Drop every Cursor and Type the walk kept: each one holds its
+        translation unit alive, and the model no longer needs them.
+        """
+        self._queued_macros.clear()
+        self._filtered_macros.clear()
+        self._queued_by_name.clear()
+        self._deferred_types.clear()
+        self._wanted_usrs.clear()
+        self._unresolved_fields.clear()
+        self._seen_usrs.clear()
+        self._source_cache.clear()
+        self._macro_tokens.clear()
+        self._function_macros.clear()
+        self._inline_bodies.clear()
+
+    def _file_allowed(self, file_name: str) -> bool:
+        """Whether cursors from file_name are walked at all; decided once per file."""
+        allowed = self._file_allowed_cache.get(file_name)
+        if allowed is None:
+            allowed = "usr/include" not in file_name and not (
+                self.decl_filter is not None and self.decl_filter.file_denied(file_name))
+            self._file_allowed_cache[file_name] = allowed
+        return allowed
+
+    def _in_shard_file(self, file_name: str) -> bool:
+        """Whether another shard binds file_name; decided once per file."""
+        foreign = self._shard_file_cache.get(file_name)
+        if foreign is None:
+            foreign = self._shard_file_cache[file_name] = os.path.realpath(file_name) in self.shard_files
+        return foreign
+
+    def _visit_cursor(self, root: Cursor, header_path: str = "", clang_args: Optional[List[str]] = None):
+        """Walks the AST with an explicit worklist and dispatches to handlers."""
+        stack = [root]
+        while stack:
+            cursor = stack.pop()
+            location_file = cursor.location.file
+            if location_file and not self._file_allowed(location_file.name):
+                continue
+
+            kind = cursor.kind
+            # The same record definition is reachable both from the TU and from a
+            # typedef; a forward declaration shares its USR but not is_definition.
+            usr = cursor.get_usr()
+            if usr:
+                seen_key = f"{usr}#def" if kind in _RECORD_KINDS and cursor.is_definition() else usr
+                if seen_key in self._seen_usrs:
+                    continue
+                self._seen_usrs.add(seen_key)
+
+            timings.count("cursors visited")
+            if log.isEnabledFor(logging.DEBUG):
+                log.debug("Visiting cursor: %s (kind: %s)", cursor.spelling, kind)
+
+            if kind in _FILTERED_KINDS and self.decl_filter is not None and not self._keep(cursor, location_file):
+                pass  # Dropped, or parked until a kept declaration uses it
+            elif kind in _TYPE_KINDS:
+                self._handle_type_decl(cursor)
+            elif kind == CursorKind.FUNCTION_DECL:
+                self._handle_function(cursor)
+            elif kind == CursorKind.MACRO_DEFINITION:
+                log.debug("Found macro definition: %s", cursor.spelling)
+                # Queue macros to process after types so struct info is available
+                macro_file = location_file.name if location_file else ""
+                if macro_file and macro_file not in self._first_macro_by_file:
+                    self._first_macro_by_file[macro_file] = cursor.spelling
+                queued = (cursor, macro_file, clang_args or [])
+                self._note_usr("macro", cursor.spelling, cursor)
+                if self.shard_files and macro_file and self._in_shard_file(macro_file):
+                    self._filtered_macros.setdefault(cursor.spelling, queued)
+                elif self.decl_filter is None or self.decl_filter.keeps(cursor.spelling, macro_file):
+                    self._queued_macros.append(queued)
+                else:
+                    self._filtered_macros.setdefault(cursor.spelling, queued)
+
+            if kind in _DESCEND_KINDS:
+                # Reversed so children are popped, and so handled, in source order
+                stack.extend(reversed(list(cursor.get_children())))
+
+    def _handle_type_decl(self, cursor: Cursor):
+        kind = cursor.kind
         if kind == CursorKind.STRUCT_DECL:
             self._handle_struct_or_union(cursor, is_union=False)
         elif kind == CursorKind.UNION_DECL:
             self._handle_struct_or_union(cursor, is_union=True)
         elif kind == CursorKind.ENUM_DECL:
             self._handle_enum(cursor)
-        elif kind == CursorKind.FUNCTION_DECL:
-            self._handle_function(cursor)
         elif kind == CursorKind.TYPEDEF_DECL:
             self._handle_typedef(cursor)
-        elif kind == CursorKind.MACRO_DEFINITION:
-            print(f"DEBUG: Found macro definition: {cursor.spelling}")
-            # Queue macros to process after types so struct info is available
-            is_first = True
-            for prev_cursor in cursor.translation_unit.cursor.get_children():
-                if prev_cursor.kind == CursorKind.MACRO_DEFINITION and prev_cursor != cursor:
-                    is_first = False
-                    break
-            self._queued_macros.append((cursor, str(cursor.location.file), clang_args or [], is_first))
-
-        for child in cursor.get_children():
-            self._visit_cursor(child, header_path, clang_args, is_root=False)
-
-        # Only flush once, after walking the TU root
-        if is_root and self._queued_macros:
-            print(f"DEBUG: Flushing {len(self._queued_macros)} queued macros after type collection")
-            for mc, hp, ca, is_first in self._queued_macros:
-                self._handle_macro(mc, hp, ca, is_first_macro=is_first)
-            self._queued_macros.clear()
-
-    def _fix_field_types(self):
-        """Post-process field types to use contextual names instead of raw clang spelling."""
-        print("DEBUG: Post-processing field types...")
-        print(f"DEBUG: Available clang_to_contextual mappings: {list(self.clang_to_contextual.keys())}")
-
-        # Fix struct field types
-        for struct_name, struct in self.structs.items():
-            for field in struct.fields:
-                original_type = field.ntype
-                # Try to get mapped type
-                mapped_type = self._get_unnamed_object_mapping(original_type)
-                if mapped_type:
-                    field.ntype = mapped_type
-                    print(f"DEBUG: Fixed struct field '{field.name}' in '{struct_name}': '{original_type}' -> '{field.ntype}'")
-
-        # Fix union field types
-        for union_name, union in self.unions.items():
-            for field in union.fields:
-                original_type = field.ntype
-                # Try to get mapped type
-                mapped_type = self._get_unnamed_object_mapping(original_type)
-                if mapped_type:
-                    field.ntype = mapped_type
-                    print(f"DEBUG: Fixed union field '{field.name}' in '{union_name}': '{original_type}' -> '{field.ntype}'")
-
-    def _map_anonymous_field_types(self):
+
+    def _keep(self, cursor: Cursor, location_file) -> bool:
         """
-        Post-processes field types to map anonymous and unnamed types
-        to their contextual names if they were previously mapped.
+        Whether decl_filter keeps a declaration. Types it does not select are
+        parked by USR for _require; anonymous records are always parked, as
+        only the typedef or field that names them decides.
         """
-        print("DEBUG: Post-processing anonymous field types...")
-        print(f"DEBUG: Available clang_to_contextual mappings: {list(self.clang_to_contextual.keys()) if self.clang_to_contextual else 'none'}")
-
-        # Iterate through all structs and unions to find anonymous/unnamed types
-        for struct_name, struct in self.structs.items():
-            for field in struct.fields:
-                if "anonymous" in field.ntype or "unnamed" in field.ntype:
-                    print(f"DEBUG: Found anonymous/unnamed struct field '{field.name}' in '{struct_name}': '{field.ntype}'")
-                    mapped_type = self._get_unnamed_object_mapping(field.ntype)
-                    if mapped_type:
-                        field.ntype = mapped_type
-                        print(f"DEBUG: Mapped struct field '{field.name}' from '{field.ntype}' to '{mapped_type}'")
-
-        for union_name, union in self.unions.items():
-            for field in union.fields:
-                if "anonymous" in field.ntype or "unnamed" in field.ntype:
-                    print(f"DEBUG: Found anonymous/unnamed union field '{field.name}' in '{union_name}': '{field.ntype}'")
-                    mapped_type = self._get_unnamed_object_mapping(field.ntype)
-                    if mapped_type:
-                        field.ntype = mapped_type
-                        print(f"DEBUG: Mapped union field '{field.name}' from '{field.ntype}' to '{mapped_type}'")
+        kind = cursor.kind
+        name = "" if kind in _RECORD_KINDS and self._is_anonymous_record(cursor) else cursor.spelling
+        file_name = location_file.name if location_file else ""
+        if self.decl_filter.denies(name, file_name):
+            timings.count("declarations filtered")
+            return False
+        if name and self.decl_filter.allows(name, file_name):
+            return True
+        if kind in _TYPE_KINDS:
+            usr = cursor.get_usr()
+            if not usr:
+                return True
+            if usr in self._wanted_usrs:
+                timings.count("types pulled in")
+                return True
+            if kind not in _RECORD_KINDS or cursor.is_definition():
+                self._deferred_types[usr] = cursor
+        timings.count("declarations filtered")
+        return False
+
+    def _require(self, decl: Cursor):
+        """Handle a type the filter parked, now that a kept declaration uses it."""
+        if self.decl_filter is None:
+            return
+        usr = decl.get_usr()
+        if not usr:
+            return
+        cursor = self._deferred_types.pop(usr, None)
+        if cursor is None:
+            # Not reached by the walk yet (or already bound): keep it when it is
+            self._wanted_usrs.add(usr)
+            return
+        timings.count("types pulled in")
+        self._handle_type_decl(cursor)
+
+    def _flush_queued_macros(self):
+        """Handle every macro queued during the walk; clang evaluations are only queued here."""
+        if not self._queued_macros:
+            return
+        log.debug("Flushing %s queued macros after type collection", len(self._queued_macros))
+        timings.count("macros queued", len(self._queued_macros))
+        self._build_header_guard_table()
+        # The only token extraction per macro; digests follow references into
+        # other macros, so index them all before handling any
+        for queued in self._queued_macros:
+            mc = queued[0]
+            self._macro_tokens.setdefault(mc.spelling, [t.spelling for t in mc.get_tokens()])
+            self._queued_by_name.setdefault(mc.spelling, queued)
+        for name, queued in self._filtered_macros.items():
+            self._queued_by_name.setdefault(name, queued)
+        self._macro_files = {name: queued[1] for name, queued in self._queued_by_name.items()}
+        self._enum_values = {m.name: m.value for e in self.enums.values() for m in e.members}
+        before = len(self.constants)
+        for mc, hp, ca in self._queued_macros:
+            self._handle_macro(mc, hp, ca)
+        self._queued_macros.clear()
+        self._queued_by_name.clear()
+        timings.count("macros resolved fast", len(self.constants) - before)
+
+    def _cursor_source(self, cursor: Cursor) -> str:
+        """The raw source text covered by a cursor's extent."""
+        extent = cursor.extent
+        if not extent or not extent.start.file:
+            return cursor.spelling
+        file_name = str(extent.start.file)
+        data = self._source_cache.get(file_name)
+        if data is None:
+            try:
+                with open(file_name, "rb") as f:
+                    data = f.read()
+            except OSError:
+                data = b""
+            self._source_cache[file_name] = data
+        return data[extent.start.offset:extent.end.offset].decode(errors="replace")
+
+    def _decl_digest(self, source: str, kind: str) -> str:
+        """
+        Digest of a declaration's source plus the current mapping of every
+        identifier it mentions, so a changed typedef or record invalidates it,
+        and of the filter rules, which decide the records there are to mention.
+        """
+        h = hashlib.sha256(f"{kind}\0{self._filter_stamp}\0{source}".encode())
+        for ident in sorted(set(re.findall(r"[A-Za-z_]\w*", source))):
+            deps = []
+            if ident in self.typedefs:
+                deps.append(f"t={self.typedefs[ident]}")
+            if ident in self.structs:
+                deps.append("s=" + ",".join(f"{f.ntype} {f.name}" for f in self.structs[ident].fields))
+            if ident in self.union_sizes:
+                deps.append(f"u={self.union_sizes[ident]}")
+            if deps:
+                h.update(f"\0{ident}:{';'.join(deps)}".encode())
+        return h.hexdigest()
+
+    def _macro_digest(self, macro_name: str) -> str:
+        """Macro digest over its replacement and every macro it transitively references."""
+        seen: Set[str] = set()
+        pending = [macro_name]
+        parts: List[str] = []
+        while pending:
+            name = pending.pop()
+            if name in seen:
+                continue
+            seen.add(name)
+            if name in self._enum_values:
+                # Folded macros bake enum values in
+                parts.append(f"{name}=enum {self._enum_values[name]}")
+            if name not in self._macro_tokens:
+                continue
+            text = ' '.join(self._macro_tokens[name])
+            parts.append(f"{name}={text}")
+            pending.extend(re.findall(r"[A-Za-z_]\w*", text))
+        return self._decl_digest("\n".join(sorted(parts)), "macro")
+
+    def _store_macro_cache_entries(self):
+        """Record this run's macro results once every fallback evaluation has landed."""
+        if self.decl_cache is None:
+            return
+        for name, (key, digest) in self._macro_cache_keys.items():
+            const = self.constants.get(name)
+            self.decl_cache.store(key, digest, dataclasses.asdict(const) if const else None)
+            self._decl_keys[("const", name)] = key
+        self._macro_cache_keys.clear()
+
+    def _build_header_guard_table(self):
+        """Work out, once per file, whether its first macro is a classic include guard."""
+        for file_name, first_macro in self._first_macro_by_file.items():
+            if file_name in self._header_guards:
+                continue
+            try:
+                with open(file_name, "r", errors="replace") as f:
+                    text = f.read()
+            except OSError:
+                text = ""
+            # Comments can hold anything (license banners, commented-out directives)
+            text = re.sub(r"/\*[\s\S]*?\*/|//[^\n]*", "", text)
+            pragma_once = re.search(r"^[ \t]*#[ \t]*pragma[ \t]+once\b", text, re.MULTILINE) is not None
+            guard = None
+            if not pragma_once:
+                m = re.search(r"^[ \t]*#[ \t]*(?:ifndef[ \t]+(\w+)|if[ \t]+![ \t]*defined[ \t]*\(?[ \t]*(\w+))", text, re.MULTILINE)
+                name = m and (m.group(1) or m.group(2))
+                if name == first_macro:
+                    guard = name
+            self._header_guards[file_name] = HeaderGuard(first_macro=first_macro, pragma_once=pragma_once, guard=guard)
+            log.debug("Header guard info for %s: %s", file_name, self._header_guards[file_name])
+
+    def _evaluate_pending_macros(self):
+        """Evaluate every macro the fast path could not resolve, one clang parse per header."""
+        if not self._pending_macro_evals:
+            return
+        from macro_processor import MacroProcessor
+        processor = MacroProcessor(self.structs, self.unions, tu_cache=self.tu_cache)
+
+        batches: Dict[tuple[str, tuple[str, ...]], List[str]] = {}
+        for name, (header, clang_args, _) in self._pending_macro_evals.items():
+            batches.setdefault((header, tuple(clang_args)), []).append(name)
+
+        for (header, clang_args), names in batches.items():
+            log.debug("Evaluating %s macros from %s in one batch", len(names), header)
+            results = processor.process_macros(header_path=header, define_names=names, clang_args=list(clang_args),
+                                               jobs=self.macro_jobs)
+            for name in names:
+                constant = self._constant_from_result(results.get(name))
+                fallback = self._pending_macro_evals[name][2]
+                if constant:
+                    self.constants[constant.name] = constant
+                    log.debug("Added constant: %s = %s (%s)", constant.name, constant.value, constant.ctype)
+                elif fallback:
+                    self.constants[name] = fallback
+                    log.debug("[fast-num] Added constant: %s = %s (%s)", name, fallback.value, fallback.ctype)
+        self._pending_macro_evals.clear()
+
+    def _constant_from_result(self, result: Optional[str]) -> Optional[Constant]:
+        """Parse a MacroProcessor result of the form '<type> <name> = <value>;'."""
+        log.debug("Macro result: %s", result)
+        if not result:
+            return None
+        try:
+            # Find first space (end of type) and ' = ' separator
+            first_space = result.find(' ')
+            eq_pos = result.find('=')
+            semi_pos = result.rfind(';')
+            if first_space == -1 or eq_pos == -1:
+                raise ValueError("missing separators")
+            ctype = result[:first_space].strip()
+            name = result[first_space:eq_pos].strip()
+            # Remove any '=' from value start and trailing ';'
+            value = result[eq_pos+1: semi_pos if semi_pos != -1 else None].strip()
+            return Constant(name=name, value=value, ctype=ctype)
+        except Exception as e:
+            log.debug("Unexpected macro result format: %s (%s)", result, e)
+            return None
+
+    def _track_unresolved_field(self, field: StructField, c_type: Type):
+        """Remember field if its (element or pointee) type is an anonymous record not named yet."""
+        inner = c_type
+        while True:
+            if inner.kind == TypeKind.ELABORATED:
+                inner = inner.get_named_type()
+            elif inner.kind == TypeKind.CONSTANTARRAY:
+                inner = inner.get_array_element_type()
+            elif inner.kind == TypeKind.POINTER:
+                inner = inner.get_pointee()
+            else:
+                break
+        if inner.kind != TypeKind.RECORD:
+            return
+        decl = inner.get_declaration()
+        if not self._is_anonymous_record(decl):
+            return
+        key = self._record_key(decl)
+        if key is not None and key not in self.clang_to_contextual:
+            self._unresolved_fields.append((field, c_type, key))
+
+    def _resolve_anonymous_fields(self):
+        """Re-map the fields recorded by _track_unresolved_field now that every record is named."""
+        for field, c_type, key in self._unresolved_fields:
+            if key not in self.clang_to_contextual:
+                log.debug("No contextual name for anonymous field '%s' (%s)", field.name, key)
+                continue
+            original_type = field.ntype
+            field.ntype = self._map_c_type_to_nature(c_type)
+            log.debug("Fixed field '%s': '%s' -> '%s'", field.name, original_type, field.ntype)
+        self._unresolved_fields.clear()
 
     def _postprocess_constants(self):
         """Fix up constant values and types after full AST traversal."""
@@ -369,7 +699,7 @@ class BindingGenerator:
             value = const.value or ""
             # Drop empty values (e.g., header guards)
             if value == "":
-                print(f"DEBUG: Dropping empty constant '{name}'")
+                log.debug("Dropping empty constant '%s'", name)
                 self.constants.pop(name, None)
                 continue
             # Normalize struct initializers to named-field form using recursive formatter
@@ -381,7 +711,7 @@ class BindingGenerator:
                     new_value = self._format_struct_initializer(struct_name, init_body) or f"{struct_name}{{{init_body}}}"
                     new_ctype = struct_name
                     if const.ctype != new_ctype or value != new_value:
-                        print(f"DEBUG: Post-processed constant '{name}': '{const.ctype} {value}' -> '{new_ctype} {new_value}'")
+                        log.debug("Post-processed constant '%s': '%s %s' -> '%s %s'", name, const.ctype, value, new_ctype, new_value)
                     to_update[name] = Constant(name=name, value=new_value, ctype=new_ctype)
                     continue
             # Convert unknown typeof(T) to T when possible
@@ -418,7 +748,7 @@ class BindingGenerator:
                 parent_name = parent.spelling or "Anonymous"
                 return f"{parent_name}_nested_{prefix}"
 
-        return f"Anonymous_{prefix}_{cursor.hash}" # Fallback
+        return self._fallback_record_name(cursor, prefix)
 
 
     def _split_top_level(self, text: str) -> List[str]:
@@ -460,14 +790,14 @@ class BindingGenerator:
         if struct_name not in self.structs:
             return None
         field_values = self._split_top_level(inner_text)
-        print(f"DEBUG: _format_struct_initializer struct={struct_name} inner='{inner_text}' -> parts={field_values}")
+        log.debug("_format_struct_initializer struct=%s inner='%s' -> parts=%s", struct_name, inner_text, field_values)
         field_names = [f.name for f in self.structs[struct_name].fields]
         pairs: List[str] = []
         for i, fname in enumerate(field_names):
             if i >= len(field_values):
                 break
             raw_val = field_values[i]
-            print(f"DEBUG:   field {fname} type={self.structs[struct_name].fields[i].ntype} raw='{raw_val}'")
+            log.debug("  field %s type=%s raw='%s'", fname, self.structs[struct_name].fields[i].ntype, raw_val)
             # Handle designated initializers: field=value
             if raw_val.strip().startswith(f"{fname}="):
                 rhs = raw_val.split('=', 1)[1].strip()
@@ -556,19 +886,23 @@ class BindingGenerator:
                 else:
                     pairs.append(f"{fname}={raw_val}")
         formatted = f"{struct_name}{{{','.join(pairs)}}}"
-        print(f"DEBUG: _format_struct_initializer result: {formatted}")
+        log.debug("_format_struct_initializer result: %s", formatted)
         return formatted
 
 
     def _handle_struct_or_union(self, cursor: Cursor, is_union: bool):
         if not cursor.is_definition(): return
+        if self._deferred_types:
+            # Reached through its typedef; do not pull it in a second time
+            self._deferred_types.pop(cursor.get_usr(), None)
 
         prefix = "Union" if is_union else "Struct"
         decl_name = self._get_contextual_name(cursor, prefix)
 
         # For anonymous structs/unions, create a better contextual name
-        if not cursor.spelling or "anonymous" in cursor.spelling or "unnamed" in cursor.spelling:
-            print(f"DEBUG: Processing anonymous type with spelling: '{cursor.spelling}'")
+        record_key = None
+        if self._is_anonymous_record(cursor):
+            log.debug("Processing anonymous type with spelling: '%s'", cursor.spelling)
             parent = cursor.semantic_parent
             if parent and parent.kind == CursorKind.FIELD_DECL:
                 # This is a field of a struct/union, use parent context
@@ -577,95 +911,103 @@ class BindingGenerator:
                     field_name = parent.spelling
                     struct_name = parent_struct.spelling or "Anonymous"
                     decl_name = f"{struct_name}_{field_name}_{prefix}"
-                    print(f"DEBUG: Created contextual name: '{decl_name}' for field '{field_name}' in '{struct_name}'")
-                                    # Store mapping immediately
-                if cursor.spelling:
-                    unnamed_obj = self._parse_unnamed_object(cursor.spelling)
-                    if unnamed_obj:
-                        self.clang_to_contextual[unnamed_obj] = decl_name
-                        print(f"DEBUG: Stored mapping '{cursor.spelling}' -> '{decl_name}'")
+                    log.debug("Created contextual name: '%s' for field '%s' in '%s'", decl_name, field_name, struct_name)
             elif parent and parent.kind == CursorKind.STRUCT_DECL:
                 # Nested anonymous struct
                 parent_name = parent.spelling or "Anonymous"
                 decl_name = f"{parent_name}_nested_{prefix}"
-                print(f"DEBUG: Created contextual name: '{decl_name}' for nested struct in '{parent_name}'")
-                # Store mapping immediately
-                if cursor.spelling:
-                    unnamed_obj = self._parse_unnamed_object(cursor.spelling)
-                    if unnamed_obj:
-                        self.clang_to_contextual[unnamed_obj] = decl_name
-                        print(f"DEBUG: Stored mapping '{cursor.spelling}' -> '{decl_name}'")
+                log.debug("Created contextual name: '%s' for nested struct in '%s'", decl_name, parent_name)
             else:
                 # Fallback for truly anonymous types
-                decl_name = f"Anonymous_{prefix}_{cursor.hash}"
-                print(f"DEBUG: Created fallback name: '{decl_name}'")
-                # Store mapping immediately
-                if cursor.spelling:
-                    unnamed_obj = self._parse_unnamed_object(cursor.spelling)
-                    if unnamed_obj:
-                        self.clang_to_contextual[unnamed_obj] = decl_name
-                        print(f"DEBUG: Stored mapping '{unnamed_obj}' -> '{decl_name}'")
+                decl_name = self._fallback_record_name(cursor, prefix)
+                log.debug("Created fallback name: '%s'", decl_name)
+            # Store mapping immediately, keyed by the declaration itself
+            record_key = self._record_key(cursor)
+            if record_key is not None:
+                self.clang_to_contextual[record_key] = decl_name
+                self._invalidate_type_map()
+                log.debug("Stored mapping %s -> '%s'", record_key, decl_name)
 
         target_dict = self.unions if is_union else self.structs
         if decl_name in target_dict: return
 
-        print(f"Found {prefix}: {decl_name}")
+        log.info("Found %s: %s", prefix, decl_name)
 
         fields = []
         for field_cursor in cursor.get_children():
             if field_cursor.kind == CursorKind.FIELD_DECL:
                 field_name = self._sanitize_name(field_cursor.spelling)
-                nature_type = self._map_c_type_to_nature(field_cursor.type)
-
-                # Check if this type contains anonymous or unnamed and try to map it
-                if "anonymous" in nature_type or "unnamed" in nature_type:
-                    if nature_type in self.clang_to_contextual:
-                        nature_type = self.clang_to_contextual[self._parse_unnamed_object(nature_type) or UnnamedObject(is_union=False, file="", location="")]
-                        print(f"DEBUG: Mapped field type '{field_name}' from '{nature_type}' to '{self.clang_to_contextual[self._parse_unnamed_object(nature_type) or UnnamedObject(is_union=False, file="", location="")]}'")
-
-                fields.append(StructField(name=field_name, ntype=nature_type))
+                field_type = field_cursor.type
+                offset, field_size = field_cursor.get_field_offsetof(), field_type.get_size()
+                field = StructField(name=field_name, ntype=self._map_c_type_to_nature(field_type),
+                                    offset=offset if offset >= 0 else None,
+                                    size=field_size if field_size >= 0 else None,
+                                    align=field_type.get_align() if field_size >= 0 else None,
+                                    bit_width=field_cursor.get_bitfield_width() if field_cursor.is_bitfield() else None)
+                self._track_unresolved_field(field, field_cursor.type)
+                fields.append(field)
 
         if is_union:
             size = cursor.type.get_size()
             if size <= 0: return # Don't process incomplete unions
-            union_name_by_size = f"Union_{num2words(size)}_bytes"
-            self.unions[decl_name] = Union(name=union_name_by_size, size=size, fields=fields, cursor=cursor)
+            union_name_by_size = union_type_name(size)
+            self.unions[decl_name] = Union(name=union_name_by_size, size=size, fields=fields,
+                                           align=cursor.type.get_align(), file=self._decl_file(cursor))
+            self._note_usr("union", decl_name, cursor)
             # Store the original name and size mapping
             self.union_sizes[decl_name] = size
             # Map the original name to the sized name for type mapping
             self.typedefs[decl_name] = union_name_by_size
             # For unions, update the mapping to use the size-based name
-            if cursor.spelling and ("anonymous" in cursor.spelling or "unnamed" in cursor.spelling):
-                unnamed_obj = self._parse_unnamed_object(cursor.spelling)
-                if unnamed_obj:
-                    self.clang_to_contextual[unnamed_obj] = union_name_by_size
-                    print(f"DEBUG: Updated union mapping '{cursor.spelling}' -> '{union_name_by_size}'")
+            if record_key is not None:
+                self.clang_to_contextual[record_key] = union_name_by_size
+                log.debug("Updated union mapping %s -> '%s'", record_key, union_name_by_size)
+            # Uses of the union's name now map to its sized alias
+            self._invalidate_type_map()
         else:
-            self.structs[decl_name] = Struct(name=decl_name, fields=fields, cursor=cursor)
-            # Store mapping from raw clang spelling to contextual name
-            if cursor.spelling and ("anonymous" in cursor.spelling or "unnamed" in cursor.spelling):
-                unnamed_obj = self._parse_unnamed_object(cursor.spelling)
-                if unnamed_obj:
-                    self.clang_to_contextual[unnamed_obj] = decl_name
-                    print(f"DEBUG: Stored struct mapping '{cursor.spelling}' -> '{decl_name}'")
+            size = cursor.type.get_size()
+            self.structs[decl_name] = Struct(name=decl_name, fields=fields,
+                                             size=size if size > 0 else None,
+                                             align=cursor.type.get_align() if size > 0 else None,
+                                             file=self._decl_file(cursor))
+            self._note_usr("struct", decl_name, cursor)
 
 
     def _handle_enum(self, cursor: Cursor):
         enum_name = cursor.spelling
         if not enum_name or enum_name in self.enums: return
 
-        print(f"Found Enum: {enum_name}")
+        log.info("Found Enum: %s", enum_name)
+        self._note_usr("enum", enum_name, cursor)
         members = [
             EnumMember(name=c.spelling, value=c.enum_value)
             for c in cursor.get_children() if c.kind == CursorKind.ENUM_CONSTANT_DECL
         ]
-        self.enums[enum_name] = Enum(name=enum_name, members=members)
+        self.enums[enum_name] = Enum(name=enum_name, members=members, file=self._decl_file(cursor),
+                                     ntype=self._map_c_type_to_nature(cursor.enum_type))
 
     def _handle_function(self, cursor: Cursor):
         func_name = cursor.spelling
         if not func_name or func_name in self.functions: return
+        self._note_usr("fn", func_name, cursor)
+
+        cache_key = digest = None
+        if self.decl_cache is not None:
+            cache_key = f"fn:{cursor.get_usr() or func_name}"
+            digest = self._decl_digest(self._cursor_source(cursor), "fn")
+            self._decl_keys[("fn", func_name)] = cache_key
+            cached = self.decl_cache.lookup(cache_key, digest)
+            if cached is not None:
+                self.functions[func_name] = Function.from_dict(cached["model"])
+                if self.decl_filter is not None:
+                    # Pull in the types the filter parked that the cached signature uses
+                    self._map_c_type_to_nature(cursor.result_type)
+                    for p in cursor.get_arguments():
+                        self._map_c_type_to_nature(p.type)
+                log.debug("Reused cached function: %s", func_name)
+                return
 
-        print(f"Found Function: {func_name}")
+        log.info("Found Function: %s", func_name)
         return_type = self._map_c_type_to_nature(cursor.result_type)
         params = [
             Parameter(
@@ -675,11 +1017,108 @@ class BindingGenerator:
             for i, p in enumerate(cursor.get_arguments())
         ]
 
+        is_variadic = cursor.type.is_function_variadic()
         self.functions[func_name] = Function(
             name=func_name, c_name=cursor.mangled_name,
             return_type=return_type, parameters=params,
-            is_variadic=cursor.type.is_function_variadic()
+            is_variadic=is_variadic, format_arg=self._format_arg(cursor) if is_variadic else None,
+            file=self._decl_file(cursor)
         )
+        if cursor.storage_class == StorageClass.STATIC and cursor.is_definition():
+            # No symbol to link against; translated (and cached) after the walk
+            self._inline_bodies[func_name] = ([p.spelling for p in cursor.get_arguments()],
+                                              self._inline_statements(cursor), cache_key, digest)
+            return
+        if cache_key is not None and digest is not None:
+            self.decl_cache.store(cache_key, digest, dataclasses.asdict(self.functions[func_name]))
+
+    @staticmethod
+    def _format_arg(cursor: Cursor) -> Optional[int]:
+        """
+        Index of the printf-style format parameter of a variadic function:
+        the one __attribute__((format(printf, n, m))) names, else a last
+        fixed parameter of type char pointer (TraceLog, SDL_Log), else None.
+        """
+        for attr in cursor.get_children():
+            if not attr.kind.is_attribute():
+                continue
+            tokens = [t.spelling for t in attr.get_tokens()]
+            for i, token in enumerate(tokens):
+                if token.strip("_") == "format" and len(tokens) > i + 4 and "printf" in tokens[i + 2] \
+                        and tokens[i + 4].isdigit():
+                    return int(tokens[i + 4]) - 1
+        args = list(cursor.get_arguments())
+        if args:
+            pointee = args[-1].type.get_canonical().get_pointee()
+            if pointee.kind in (TypeKind.CHAR_S, TypeKind.SCHAR, TypeKind.CHAR_U, TypeKind.UCHAR):
+                return len(args) - 1
+        return None
+
+    def _inline_statements(self, cursor: Cursor) -> Optional[List[Statement]]:
+        """The body of a function definition as token statements, with what the translator cannot use marked by kind."""
+        body = next((c for c in cursor.get_children() if c.kind == CursorKind.COMPOUND_STMT), None)
+        if body is None:
+            return None
+        spellings = lambda c: [t.spelling for t in c.get_tokens()]
+        statements = []
+        for stmt in body.get_children():
+            if stmt.kind == CursorKind.RETURN_STMT:
+                value = next(iter(stmt.get_children()), None)
+                statements.append(Statement("return", spellings(value) if value is not None else []))
+            elif stmt.kind == CursorKind.DECL_STMT:
+                for var in stmt.get_children():
+                    inits = [c for c in var.get_children() if c.kind.is_expression()]
+                    if var.kind != CursorKind.VAR_DECL or not inits:
+                        statements.append(Statement("uninitialized declaration"))
+                        continue
+                    init = inits[-1]
+                    items = [spellings(c) for c in init.get_children()] if init.kind == CursorKind.INIT_LIST_EXPR else None
+                    statements.append(Statement("var", spellings(init) if items is None else [], name=var.spelling,
+                                                ntype=self._map_c_type_to_nature(var.type), items=items))
+            else:
+                statements.append(Statement(stmt.kind.name.lower()))
+        return statements
+
+    def _translate_header_code(self):
+        """
+        Turn the function-like macros and static inline functions collected
+        during the walk into Nature functions (see translate.py). Static
+        functions that cannot be translated keep their #linkid declaration,
+        for a C shim to provide; every failure is logged with its reason.
+        """
+        if not self._function_macros and not self._inline_bodies:
+            return
+        translator = Translator(self, self.reserved_keywords)
+        pending = {name: macro for name, macro in self._function_macros.items()
+                   if name not in self.functions and name not in self.constants}
+        # Macros may use macros defined after them: retry until nothing more translates
+        progress = True
+        while pending and progress:
+            progress = False
+            for name, (params, tokens, file_name) in list(pending.items()):
+                try:
+                    self.functions[name] = translator.macro(name, params, tokens, file_name)
+                except Untranslatable as e:
+                    self.untranslated[name] = str(e)
+                    continue
+                self.untranslated.pop(name, None)
+                self.translated.append(name)
+                del pending[name]
+                progress = True
+        for name, (c_params, statements, cache_key, digest) in self._inline_bodies.items():
+            func = self.functions[name]
+            try:
+                if statements is None:
+                    raise Untranslatable("no body")
+                func.body = translator.inline(func, c_params, statements)
+                self.translated.append(name)
+            except Untranslatable as e:
+                self.untranslated[name] = str(e)
+            if cache_key is not None and digest is not None:
+                self.decl_cache.store(cache_key, digest, dataclasses.asdict(func))
+        timings.count("translated to Nature", len(self.translated))
+        for name, reason in sorted(self.untranslated.items()):
+            log.info("Not translated to Nature: %s (%s)", name, reason)
 
     def _handle_typedef(self, cursor: Cursor):
         name = cursor.spelling
@@ -700,342 +1139,693 @@ class BindingGenerator:
                 # Type assertion to handle the union type
                 if is_union:
                     self.unions[name] = record  # type: ignore
+                    self._note_usr("union", name, underlying_decl)
                 else:
                     self.structs[name] = record  # type: ignore
+                    self._note_usr("struct", name, underlying_decl)
+                    record_key = self._record_key(underlying_decl)
+                    if record_key is not None:
+                        self.clang_to_contextual[record_key] = name
+                self._invalidate_type_map()
             self.typedefs[name] = name # Map the typedef name to the new record name
             return
 
         mapped_type = self._map_c_type_to_nature(underlying_type)
+        self._note_usr("typedef", name, cursor)
+        if self.typedefs.get(name, name) != mapped_type:
+            self._invalidate_type_map()
         self.typedefs[name] = mapped_type
-        print(f"Found Typedef: {name} -> {mapped_type}")
+        log.info("Found Typedef: %s -> %s", name, mapped_type)
 
-    def _handle_macro(self, cursor: Cursor, header_path: str, clang_args: List[str], is_first_macro: bool = False):
+    def _handle_macro(self, cursor: Cursor, header_path: str, clang_args: List[str]):
         macro_name = cursor.spelling
-        print(f"DEBUG: Handling macro: {macro_name}")
-        if macro_name in self.constants:
-            print(f"DEBUG: Macro {macro_name} already processed, skipping")
+        log.debug("Handling macro: %s", macro_name)
+        if (macro_name in self._handled_macros or macro_name in self.constants
+                or macro_name in self._pending_macro_evals):
+            log.debug("Macro %s already processed, skipping", macro_name)
             return
+        self._handled_macros.add(macro_name)
 
         # Skip internal/compiler macros
         if macro_name.startswith('__'):
-            print(f"DEBUG: Skipping internal macro: {macro_name}")
+            log.debug("Skipping internal macro: %s", macro_name)
             return
 
         # Skip internal macros
         if not cursor.location.file:
-            print(f"DEBUG: Skipping macro with no location: {macro_name}")
+            log.debug("Skipping macro with no location: %s", macro_name)
             return
 
-        # Skip macros from system headers (included with <>)
         file_path = str(cursor.location.file)
-        
-        # Get tokens safely
-        tokens = []
-        if cursor.extent and cursor.translation_unit:
-            try:
-                tokens = list(cursor.translation_unit.get_tokens(extent=cursor.extent))
-            except Exception as e:
-                print(f"DEBUG: Error getting tokens: {e}")
-                tokens = []
-
-        # Check for system header includes
-        for i, token in enumerate(tokens[:-2]):  # Need at least 3 tokens for include
-            if token.spelling == '#' and tokens[i + 1].spelling == 'include':
-                include_path = tokens[i + 2].spelling
-                if include_path.startswith('<') and include_path.endswith('>'):
-                    if include_path[1:-1] in file_path:
-                        print(f"DEBUG: Skipping macro from system header: {macro_name}")
-                        return
-                else:
-                    print(f"Header Path: {include_path}")
 
-        # Skip first macro if it's likely a header guard
-        if is_first_macro:
-            # Check if this file uses pragma once instead of header guards
-            has_pragma_once = False
-            if cursor.extent and cursor.translation_unit:
-                try:
-                    tokens = list(cursor.translation_unit.get_tokens(extent=cursor.extent))
-                    for i, token in enumerate(tokens[:-1]):  # Skip last token to avoid index error
-                        if token.spelling == 'pragma' and tokens[i + 1].spelling == 'once':
-                            has_pragma_once = True
-                            break
-                except Exception as e:
-                    print(f"DEBUG: Error getting tokens: {e}")
-                    has_pragma_once = False
-            
-            if not has_pragma_once:
-                print(f"DEBUG: Skipping first macro (likely header guard): {macro_name}")
+        # Skip the include guard of the file that defines this macro
+        guard_info = self._header_guards.get(file_path)
+        if guard_info and guard_info.guard == macro_name:
+            log.debug("Skipping include guard macro: %s", macro_name)
+            return
+
+        if cursor.is_macro_function_like():
+            # Translated after the walk, when every constant and function it may use is known
+            tokens = self._macro_tokens.get(macro_name) or [t.spelling for t in cursor.get_tokens()]
+            if ")" in tokens:
+                close = tokens.index(")")
+                params = [t for t in tokens[2:close] if t != ","]
+                self._function_macros[macro_name] = (params, tokens[close + 1:], file_path)
+            return
+
+        if self.decl_cache is not None and macro_name in self._macro_tokens:
+            cache_key = f"macro:{file_path}:{macro_name}"
+            digest = self._macro_digest(macro_name)
+            cached = self.decl_cache.lookup(cache_key, digest)
+            if cached is not None:
+                if cached["model"]:
+                    self.constants[macro_name] = Constant.from_dict(cached["model"])
+                self._decl_keys[("const", macro_name)] = cache_key
+                log.debug("Reused cached macro: %s", macro_name)
                 return
+            self._macro_cache_keys[macro_name] = (cache_key, digest)
 
-        # Try a fast path: parse the macro replacement directly from the macro definition tokens
-        fast_tokens = []
-        if cursor.extent:
-            try:
-                fast_tokens = list(cursor.get_tokens())
-            except Exception as e:
-                print(f"DEBUG: Could not read macro tokens for fast path: {e}")
-                fast_tokens = []
+        kind, expr = self._classify_macro(cursor)
+        replacement = self._macro_tokens[macro_name][1:]
+        log.debug("Macro %s classified as %s", macro_name, kind)
+        if kind == "skip":
+            return
 
-        if fast_tokens:
-            # Expect a pattern like: #, define, NAME, <replacement...>
-            try:
-                name_index = next(i for i, t in enumerate(fast_tokens) if t.spelling == macro_name)
-            except StopIteration:
-                name_index = -1
-            if name_index != -1 and name_index + 1 < len(fast_tokens):
-                # Skip function-like macro definitions (NAME(...))
-                if fast_tokens[name_index + 1].spelling == '(':
-                    print(f"DEBUG: Skipping function-like macro def: {macro_name}")
-                    return
-                replacement_tokens = fast_tokens[name_index + 1:]
-                replacement = ''.join(t.spelling for t in replacement_tokens).strip()
-                print(f"DEBUG: Macro replacement for {macro_name}: '{replacement}'")
-                if replacement:
-                    # Detect struct compound literals: (Type){...} or Type{...}
-                    import re as _re
-                    # Handle CLITERAL(Type){...} → Type{...}
-                    m_clit = _re.match(r"^CLITERAL\s*\(\s*(?:struct\s+)?(\w+)\s*\)\s*\{([\s\S]*)\}$", replacement)
-                    if m_clit:
-                        struct_name = m_clit.group(1)
-                        if struct_name in self.structs:
-                            raw_vals = m_clit.group(2)
-                            value = self._format_struct_initializer(struct_name, raw_vals) or f"{struct_name}{{{raw_vals}}}"
-                            ctype = struct_name
-                            self.constants[macro_name] = Constant(name=macro_name, value=value, ctype=ctype)
-                            print(f"DEBUG: [fast-CLITERAL] Added constant: {macro_name} = {value} ({ctype})")
-                            return
-                        # Fallthrough to processor if unknown struct
-                    m = _re.match(r"^\(\s*(?:struct\s+)?(\w+)\s*\)\s*\{([\s\S]*)\}$", replacement)
-                    if not m:
-                        m = _re.match(r"^(?:struct\s+)?(\w+)\s*\{([\s\S]*)\}$", replacement)
-                    if m:
-                        struct_name = m.group(1)
-                        if struct_name in self.structs:
-                            raw_vals = m.group(2)
-                            value = self._format_struct_initializer(struct_name, raw_vals) or f"{struct_name}{{{raw_vals}}}"
-                            ctype = struct_name
-                            self.constants[macro_name] = Constant(name=macro_name, value=value, ctype=ctype)
-                            print(f"DEBUG: [fast-struct] Added constant: {macro_name} = {value} ({ctype})")
-                            return
-                        else:
-                            # Unknown struct; fall back to processor
-                            from macro_processor import MacroProcessor
-                            processor = MacroProcessor(self.structs, self.unions)
-                            result = processor.process_macro(header_path=str(cursor.location.file), define_name=macro_name, clang_args=clang_args)
-                            if result:
-                                try:
-                                    first_space = result.find(' ')
-                                    eq_pos = result.find('=')
-                                    semi_pos = result.rfind(';')
-                                    ctype = result[:first_space].strip()
-                                    name = result[first_space:eq_pos].strip()
-                                    value = result[eq_pos+1: semi_pos if semi_pos != -1 else None].strip()
-                                    self.constants[name] = Constant(name=name, value=value, ctype=ctype)
-                                    print(f"DEBUG: [fast->proc] Added constant: {name} = {value} ({ctype})")
-                                    return
-                                except Exception:
-                                    pass
-                    # Determine a simple or alias type
-                    # Skip pure identifier aliases (likely unresolved or function aliases)
-                    if _re.fullmatch(r"[A-Za-z_]\w*", replacement):
-                        # If it aliases a known function, definitely skip
-                        if replacement in self.functions:
-                            print(f"DEBUG: Skipping function alias macro: {macro_name} -> {replacement}")
-                            return
-                        print(f"DEBUG: Skipping identifier alias macro: {macro_name} -> {replacement}")
-                        return
-                    # Skip function-like invocations e.g. (n,sz)calloc(n,sz) or free(ptr)
-                    if '(' in replacement and ')' in replacement and not replacement.startswith('(') and '){' not in replacement:
-                        print(f"DEBUG: Skipping invocation-like macro: {macro_name} -> {replacement}")
-                        return
-                    # Strings
-                    if replacement.startswith('"') and replacement.endswith('"'):
-                        ctype = 'anyptr'
-                        value = f"{replacement}.ref()"
-                        self.constants[macro_name] = Constant(name=macro_name, value=value, ctype=ctype)
-                        print(f"DEBUG: [fast-str] Added constant: {macro_name} = {value} ({ctype})")
-                        return
-                    # Numeric or arithmetic expressions
-                    # Normalize float suffix 'f' and drop redundant outer parens
-                    def _strip_outer_parens(s: str) -> str:
-                        if s.startswith('(') and s.endswith(')'):
-                            # simple balance check
-                            depth=0
-                            for i,ch in enumerate(s):
-                                if ch=='(':
-                                    depth+=1
-                                elif ch==')':
-                                    depth-=1
-                                    if depth==0 and i!=len(s)-1:
-                                        return s
-                            return s[1:-1]
-                        return s
-                    norm = replacement
-                    norm = norm.replace('f)', ')')
-                    norm = norm.replace('f*', '*')
-                    norm = norm.replace('f/', '/')
-                    norm = norm.replace('f+', '+')
-                    norm = norm.replace('f-', '-')
-                    # strip trailing f on lone numbers
-                    norm = _re.sub(r"(?<=\d)f\b", "", norm)
-                    norm = _strip_outer_parens(norm)
-                    ctype = 'f32' if any(c in norm for c in ['.', 'e', 'E']) else 'i32'
-                    self.constants[macro_name] = Constant(name=macro_name, value=norm, ctype=ctype)
-                    print(f"DEBUG: [fast-num] Added constant: {macro_name} = {norm} ({ctype})")
-                    return
-
-        # Get the actual header file path
-        actual_header = str(cursor.location.file)
-        print(f"DEBUG: Using header path: {actual_header}")
+        if kind == "string":
+            value = render_expr(expr)
+            self.constants[macro_name] = Constant(name=macro_name, value=value, ctype='anyptr')
+            log.debug("[fast-str] Added constant: %s = %s (anyptr)", macro_name, value)
+            return
 
-        from macro_processor import MacroProcessor
-        processor = MacroProcessor(self.structs, self.unions)
-        result = processor.process_macro(
-            header_path=actual_header,
-            define_name=macro_name,
-            clang_args=clang_args
-        )
-        print(f"DEBUG: Macro result: {result}")
-        
-        if result:
-            # Parse the result which should be in format "<type> <name> = <value>;"
-            try:
-                # Find first space (end of type) and ' = ' separator
-                first_space = result.find(' ')
-                eq_pos = result.find('=')
-                semi_pos = result.rfind(';')
-                if first_space == -1 or eq_pos == -1:
-                    raise ValueError("missing separators")
-                ctype = result[:first_space].strip()
-                name = result[first_space:eq_pos].strip()
-                # Remove any '=' from value start and trailing ';'
-                value = result[eq_pos+1: semi_pos if semi_pos != -1 else None].strip()
-                self.constants[name] = Constant(name=name, value=value, ctype=ctype)
-                print(f"DEBUG: Added constant: {name} = {value} ({ctype})")
-            except Exception as e:
-                print(f"DEBUG: Unexpected macro result format: {result} ({e})")
-
-
-    def generate_bindings(self) -> str:
-        """Generates the full Nature language binding code as a string."""
-
-        def generate_constants_and_enums():
-            lines = []
-            if self.constants:
-                lines.append("// Constants from Macros")
-                # Simple alphabetical sort is sufficient for most cases
-                for const in sorted(self.constants.values(), key=lambda c: c.name):
-                    lines.append(f"{const.ctype} {const.name} = {const.value}")
-
-            if self.enums:
-                lines.append("\n// Enum Constants")
-                for enum in self.enums.values():
-                    for member in enum.members:
-                        lines.append(f"int {enum.name}_{member.name} = {member.value}")
-            return "\n".join(lines)
-
-        def generate_records():
-            lines = []
-            # Generate unions first, as they are simple type aliases
-            if self.unions:
-                lines.append("\n// Union Definitions (as byte arrays)\n")
-                # Use a set to only define each size-based union type once
-                defined_unions = set()
-                for union in self.unions.values():
-                    if union.name not in defined_unions:
-                        lines.append(union.to_nature())
-                        # Add helper constructor for writing typed value into byte array
-                        if union.size in (4, 8):
-                            elem_count = union.size
-                            zeros = ",".join(["zero"] * elem_count)
-                            lines.append("")
-                            lines.append(f"fn new{union.name}<T>(T value):{union.name} {{")
-                            lines.append("    u8 zero = 0 as u8")
-                            lines.append(f"    {union.name} result = [{zeros}]")
-                            lines.append(f"    result as anyptr as rawptr<T> as T = value")
-                            lines.append("    return result")
-                            lines.append("}")
-                        defined_unions.add(union.name)
-
-            if self.structs:
-                lines.append("\n// Struct Definitions")
-                for struct in self.structs.values():
-                    lines.append(f"type {struct.name} = struct {{")
-                    for f in struct.fields:
-                        lines.append(f"    {f.ntype} {f.name}")
-                    lines.append("}")
-                    lines.append("")
-            return "\n".join(lines)
-
-        def generate_functions():
-            lines = ["\n// Function Bindings"]
-            for func in self.functions.values():
-                # Add linkid tag for C interop
-                lines.append(f'#linkid {func.c_name}')
-
-                param_list = ", ".join(f"{p.ntype} {p.name}" for p in func.parameters)
-
-                # Handle variadic functions according to Nature syntax
-                if func.is_variadic:
-                    if param_list: param_list += ", "
-                    # Assuming variadic params are ints; this could be made configurable
-                    param_list += "...[any] args"
-
-                return_type = f":{func.return_type}" if func.return_type != "void" else ""
-                lines.append(f"fn {func.name}({param_list}){return_type}\n")
-            return "\n".join(lines)
-
-        # Assemble the final code
-        header = "// Generated Nature bindings\n// This file was automatically generated naturebindgen.\n"
-        code_parts = [
-            header,
-            generate_constants_and_enums(),
-            generate_records(),
-            generate_functions(),
-        ]
-        return "\n".join(filter(None, code_parts))
+        if kind == "literal":
+            struct_name = expr.type_name
+            if struct_name in self.structs:
+                # Everything between the outermost braces, as written
+                raw_vals = ''.join(replacement[replacement.index('{') + 1:-1])
+                value = self._format_struct_initializer(struct_name, raw_vals) or f"{struct_name}{{{raw_vals}}}"
+                self.constants[macro_name] = Constant(name=macro_name, value=value, ctype=struct_name)
+                log.debug("[fast-struct] Added constant: %s = %s (%s)", macro_name, value, struct_name)
+                return
+            # Unknown struct; let clang type it, keeping the literal as a fallback
+            ctype, value = render_constant(expr, self.structs, self.unions)
+            fallback = Constant(name=macro_name, value=value, ctype=ctype)
+            self._pending_macro_evals[macro_name] = (file_path, clang_args, fallback)
+            log.debug("[fast->proc] Queued %s for evaluation", macro_name)
+            return
+
+        if kind in ("number", "alias"):
+            folded = fold(expr, self._constant_value)
+            rendered = render_value(folded) if folded is not None else None
+            if rendered is not None:
+                ctype, value = rendered
+                timings.count("macros folded")
+                log.debug("[fast-fold] Added constant: %s = %s (%s)", macro_name, value, ctype)
+                self.constants[macro_name] = Constant(name=macro_name, value=value, ctype=ctype)
+                return
+            if kind == "alias":
+                # Pure identifier aliases of anything but a constant are likely
+                # unresolved or function aliases
+                log.debug("Skipping identifier alias macro: %s -> %s", macro_name, expr.name)
+                return
+            rendered = render_constant(expr, self.structs, self.unions)
+            if rendered is not None:
+                ctype, value = rendered
+                log.debug("[fast-num] Added constant: %s = %s (%s)", macro_name, value, ctype)
+                self.constants[macro_name] = Constant(name=macro_name, value=value, ctype=ctype)
+                return
+            # e.g. a conditional or member access render_constant cannot write; clang evaluates it
+
+        # Evaluated later together with every other macro from this header. The
+        # replacement as written is kept in case clang cannot type it either.
+        text = ''.join(replacement)
+        ctype = 'f32' if any(t.kind == 'number' and ('.' in t.text or 'e' in t.text.lower())
+                             and not t.text.lower().startswith('0x')
+                             for t in tokens_from_spellings(replacement)) else 'i32'
+        fallback = Constant(name=macro_name, value=text, ctype=ctype)
+        self._pending_macro_evals[macro_name] = (file_path, clang_args, fallback)
+
+    def _constant_value(self, name: str) -> Optional[CValue]:
+        """
+        Folded value of an identifier inside a macro expression: an enum member,
+        or a macro folded to a literal. Macros queued later in the header are
+        handled on the spot so references do not depend on definition order.
+        """
+        if name in self._enum_values:
+            return CValue(self._enum_values[name], 'int')
+        if name not in self.constants and name not in self._handled_macros:
+            queued = self._queued_by_name.get(name)
+            if queued is not None:
+                self._handle_macro(*queued)
+        const = self.constants.get(name)
+        return value_of_constant(const.ctype, const.value) if const else None
+
+    def _classify_macro(self, cursor: Cursor) -> tuple[str, Optional[Expr]]:
+        """
+        Decide once, from the macro's tokens, how it is bound: "skip" (empty,
+        function-like or invocation), "alias" (a lone identifier), "string",
+        "number" (an arithmetic expression), "literal" (a compound literal) or
+        "eval" when only clang can type it.
+        """
+        macro_name = cursor.spelling
+        if macro_name not in self._macro_tokens:
+            self._macro_tokens[macro_name] = [t.spelling for t in cursor.get_tokens()]
+        replacement = self._macro_tokens[macro_name][1:]
+        if not replacement:
+            return "skip", None
+        if cursor.is_macro_function_like():
+            log.debug("Skipping function-like macro def: %s", macro_name)
+            return "skip", None
+
+        expr = parse_macro_tokens(tokens_from_spellings(replacement))
+        if expr is None:
+            return "eval", None
+        if isinstance(expr, Identifier):
+            return "alias", expr
+        if isinstance(expr, String):
+            return "string", expr
+        if isinstance(expr, CompoundLiteral):
+            return "literal", expr
+        if has_call(expr):
+            # e.g. calloc(n,sz) or SDL_FOURCC(...)
+            log.debug("Skipping invocation-like macro: %s", macro_name)
+            return "skip", expr
+        return "number", expr
 
 
 # --- Main Execution ---
+@dataclasses.dataclass
+class Job:
+    """One header to bind and where to write the result."""
+    header: str
+    output: str
+    clang_args: List[str]
+    depfile: Optional[str] = None  # Makefile-style dependency file to write
+    decl_filter: Optional[DeclFilter] = None
+    used_by: List[str] = dataclasses.field(default_factory=list)  # Nature sources to prune to
+    split: bool = False  # One module per originating header beside output (see split.py)
+    dump_model: Optional[str] = None  # Where to save the collected model (see model.py)
+    emit: EmitOptions = dataclasses.field(default_factory=EmitOptions)
+    links: List[Library] = dataclasses.field(default_factory=list)  # Loaded libraries to check functions against
+    keep_unexported: bool = False
+
+    def settings(self) -> List[str]:
+        """Everything besides the input files that shapes the output, for its stamp."""
+        return (self.clang_args + (self.decl_filter.settings() if self.decl_filter else [])
+                + [f"used_by={os.path.abspath(p)}" for p in self.used_by] + (["split"] if self.split else [])
+                + self.emit.settings() + [f"link={lib.name}={os.path.abspath(lib.path)}" for lib in self.links]
+                + (["keep_unexported"] if self.keep_unexported else []))
+
+
+def _write_depfile(job: Job, deps: List[str]):
+    if job.depfile:
+        write_if_changed(job.depfile, format_depfile(job.output, deps))
+
+
+def collect_shard(shard: Shard, clang_args: List[str], decl_filter: Optional[DeclFilter], cache_dir: Optional[str],
+                  incremental: bool, shard_files: List[str], log_level: str) -> Dict:
+    """
+    Parse and walk one sub-header of an umbrella in a worker process (see
+    parse_umbrella). Returns its model with what the merge needs besides:
+    declaration USRs, translation results, includes and counters.
+    """
+    configure_logging(log_level)
+    timings.reset()
+    clang_args = shard.clang_args(clang_args)
+    decl_cache = DeclCache.for_header(cache_dir, shard.header, clang_args) if incremental and cache_dir else None
+    generator = BindingGenerator(tu_cache=TUCache(cache_dir) if cache_dir else None, decl_cache=decl_cache,
+                                 decl_filter=decl_filter)
+    generator.shard_files = set(shard_files) - {shard.header}
+    generator.decl_usrs = {}
+    tu = generator.parse_header(shard.header, clang_args)
+    errors = [diag.spelling for diag in tu.diagnostics if diag.severity >= diag.Error]
+    includes = [inc.include.name for inc in tu.get_includes()]
+    del tu
+    if decl_cache is not None:
+        decl_cache.save()
+    return {
+        "model": generator.to_dict(),
+        "usrs": [[kind, name, usr] for (kind, name), usr in generator.decl_usrs.items()],
+        "translated": generator.translated,
+        "untranslated": generator.untranslated,
+        "includes": includes,
+        "errors": errors,
+        "counters": dict(timings.counters),
+        "cache": [decl_cache.hits, decl_cache.misses] if decl_cache is not None else None,
+    }
+
+
+def parse_umbrella(generator: BindingGenerator, job: Job, options: argparse.Namespace
+                   ) -> Optional[tuple[List[str], List[str]]]:
+    """
+    Collect job.header into generator shard by shard, options.umbrella_jobs
+    at a time (see shards.py). Returns the files the shards included and
+    summary lines, or None for the caller to parse the header whole: when it
+    is no plain umbrella, a sub-header does not compile on its own, or the
+    worker pool breaks.
+    """
+    from concurrent.futures import ProcessPoolExecutor
+    from concurrent.futures.process import BrokenProcessPool
+    shards = umbrella_shards(job.header, job.clang_args)
+    if shards is None:
+        log.info("%s is not an umbrella of independent headers, parsing it whole", job.header)
+        return None
+    n = len(shards)
+    level = logging.getLevelName(log.getEffectiveLevel()).lower()
+    try:
+        with timings.phase("sharded parse"), ProcessPoolExecutor(max_workers=min(options.umbrella_jobs, n)) as pool:
+            # map yields in shard order, whatever order the shards finish in
+            results = list(pool.map(collect_shard, shards, [job.clang_args] * n, [job.decl_filter] * n,
+                                    [options.cache_dir] * n, [options.incremental] * n,
+                                    [[s.header for s in shards]] * n, [level] * n))
+    except (BrokenProcessPool, OSError) as e:
+        log.warning("Sharded parsing failed (%s), parsing %s whole", e, job.header)
+        return None
+    for shard, result in zip(shards, results):
+        if result["errors"]:
+            log.warning("%s does not compile on its own (%s), parsing %s whole",
+                        shard.header, result["errors"][0], job.header)
+            return None
+
+    generator.header = os.path.abspath(job.header)
+    merger = ShardMerger(generator)
+    includes: List[str] = []
+    hits = misses = 0
+    with timings.phase("shard merge"):
+        for shard, result in zip(shards, results):
+            merger.merge(shard.header, result["model"], {(k, name): usr for k, name, usr in result["usrs"]})
+            merger.merge_translations(result["translated"], result["untranslated"])
+            includes += [shard.header] + result["includes"]
+            for name, count in result["counters"].items():
+                timings.count(name, count)
+            if result["cache"]:
+                hits, misses = hits + result["cache"][0], misses + result["cache"][1]
+        merger.finish()
+    for conflict in merger.conflicts:
+        log.warning("Conflicting definition: %s", conflict)
+    summary = [f"Shards: {n} sub-headers parsed in parallel, "
+               f"{len(merger.conflicts)} conflicting definitions (the first was kept)"]
+    if options.incremental and options.cache_dir:
+        summary.append(f"Incremental cache: {hits} reused, {misses} regenerated")
+    return includes, summary
+
+
+def run_job(job: Job, options: argparse.Namespace) -> str:
+    """
+    Parse one header and write its bindings. Runs in a worker process in
+    multi-header mode, so everything it needs (Index, generator, caches) is
+    created here. Returns the parsing summary for the caller to print.
+    With options.check, a header whose stamp shows nothing changed is
+    skipped before libclang is involved at all.
+    """
+    cache_dir = options.cache_dir
+    timings.reset()
+    stamp = Stamp.for_output(job.output)
+    if options.check:
+        deps = stamp.fresh_dependencies(job.header, job.settings(), job.output)
+        if deps is not None:
+            _write_depfile(job, deps)
+            return f"Up to date: {job.output}"
+
+    decl_cache = DeclCache.for_header(cache_dir, job.header, job.clang_args) if options.incremental and cache_dir else None
+    generator = BindingGenerator(
+        tu_cache=TUCache(cache_dir) if cache_dir else None,
+        decl_cache=decl_cache,
+        decl_filter=job.decl_filter,
+        macro_jobs=getattr(options, "macro_jobs", 1)
+    )
+    sharded = parse_umbrella(generator, job, options) if getattr(options, "umbrella_jobs", 1) > 1 else None
+    if sharded is not None:
+        includes, shard_summary = sharded
+        # Each shard kept its own cache; this one would only be emptied
+        decl_cache = generator.decl_cache = None
+    else:
+        tu = generator.parse_header(job.header, job.clang_args)
+        includes, shard_summary = [inc.include.name for inc in tu.get_includes()], []
+        with timings.phase("release tu"):
+            # The generator holds no clang objects any more, so this frees the TU
+            del tu
+    deps = dependencies(job.header, includes + job.used_by + [lib.path for lib in job.links])
+    if job.dump_model:
+        # The whole model, so other runs can prune or split it differently
+        generator.save(job.dump_model)
+    symbol_report = verify_exports(generator, job.links, job.keep_unexported) if job.links else []
+    if job.used_by:
+        prune_to_sources(generator, job.output, job.used_by)
+
+    summary = [
+        f"--- Parsing Summary: {job.header} ---",
+        f"Structs: {len(generator.structs)}, Unions: {len(generator.unions)}, Enums: {len(generator.enums)}",
+        f"Functions: {len(generator.functions)}, Constants: {len(generator.constants)}, Typedefs: {len(generator.typedefs)}",
+    ]
+    if generator.translated or generator.untranslated:
+        summary.append(f"Translated to Nature: {len(generator.translated)} macros and inline functions; "
+                       f"{len(generator.untranslated)} could not be (listed with --log-level info)")
+    summary += shard_summary + symbol_report
+
+    with timings.phase("emission"):
+        outputs, written = write_bindings(generator, job.output, job.split, job.emit)
+    if job.split:
+        summary.append(f"Modules: {', '.join(os.path.basename(p) for p in outputs)}")
+    _write_depfile(job, deps)
+    if options.check or job.depfile:
+        stamp.save(job.header, job.settings(), outputs, deps)
+
+    if decl_cache is not None:
+        decl_cache.save()
+        summary.append(f"Incremental cache: {decl_cache.hits} reused, {decl_cache.misses} regenerated")
+
+    if job.output == STDOUT:
+        summary.append("Successfully generated Nature bindings to stdout")
+    elif written:
+        summary.append(f"Successfully generated Nature bindings at: {job.output}")
+    else:
+        summary.append(f"Bindings unchanged, left as is: {job.output}")
+    if options.timings:
+        hits, misses = timings.counters.get("type map hits", 0), timings.counters.get("type map misses", 0)
+        if hits + misses:
+            summary.append(f"Type mapping cache: {hits} hits, {misses} misses "
+                           f"({hits / (hits + misses) * 100:.1f}% hit rate)")
+        summary.append(timings.report(f"Timings: {job.header}"))
+    return "\n".join(summary)
+
+
+def load_manifest(path: str, include_dirs: List[str], decl_filter: Optional[DeclFilter] = None) -> List[Job]:
+    """
+    Read a TOML manifest listing headers to bind:
+
+        include_dirs = ["vendor/include"]      # optional, applies to every header
+        [filter]                               # optional, applies to every header
+        allow_prefix = ["SDL_"]                # any of filters.RULE_KEYS
+
+        [[header]]
+        path = "tests/raylib.h"
+        output = "raylib.n"                    # optional, defaults to <stem>.n
+        include_dirs = ["extra"]               # optional
+        depfile = "raylib.n.d"                 # optional
+        filter = { deny = ["Draw.*Ex"] }       # optional, added to the common rules
+        used_by = ["main.n"]                   # optional, see BindingGenerator.prune_unused
+        split = true                           # optional, like --split
+        consts = true                          # optional, like --consts
+        printf_overloads = true                # optional, like --printf-overloads
+        variadic_overloads = { TraceLog = [["i32", "f64"]] }  # optional, like --variadic-overload
+        profile_bindings = true                # optional, like --profile-bindings
+
+    Relative paths are resolved against the manifest's directory.
+    """
+    import tomllib
+    with open(path, "rb") as f:
+        data = tomllib.load(f)
+    base = os.path.dirname(os.path.abspath(path))
+    resolve = lambda p: p if os.path.isabs(p) else os.path.join(base, p)
+
+    common = [resolve(d) for d in data.get("include_dirs", [])] + include_dirs
+    common_filter = DeclFilter.from_rules(data.get("filter", {}))
+    if decl_filter is not None:
+        common_filter = decl_filter.merged(common_filter)
+    jobs = []
+    for entry in data.get("header", []):
+        header = resolve(entry["path"])
+        output = resolve(entry.get("output") or os.path.splitext(os.path.basename(header))[0] + ".n")
+        dirs = common + [resolve(d) for d in entry.get("include_dirs", [])]
+        depfile = resolve(entry["depfile"]) if entry.get("depfile") else None
+        entry_filter = DeclFilter.from_rules(entry.get("filter", {}))
+        if common_filter is not None:
+            entry_filter = common_filter.merged(entry_filter)
+        emit = EmitOptions(consts=bool(entry.get("consts", False)),
+                           printf_overloads=bool(entry.get("printf_overloads", False)),
+                           profile=bool(entry.get("profile_bindings", False)))
+        for name, signatures in entry.get("variadic_overloads", {}).items():
+            for arg_types in signatures:
+                emit.add_overload(*overload_spec(f"{name}:{','.join(arg_types)}"))
+        jobs.append(Job(header=header, output=output, clang_args=[f"-I{d}" for d in dirs],
+                        depfile=depfile, decl_filter=entry_filter,
+                        used_by=[resolve(p) for p in entry.get("used_by", [])],
+                        split=bool(entry.get("split", False)), emit=emit))
+    return jobs
+
+
 def main():
     """Command-line interface for the binding generator."""
     parser = argparse.ArgumentParser(
-        description="Generate Nature language bindings from a C header file."
+        description="Generate Nature language bindings from C header files."
+    )
+    parser.add_argument("headers", nargs="*", metavar="header", help="Path to the C header file(s) to parse.")
+    parser.add_argument(
+        "-o", "--output", default=None,
+        help="Path to the output Nature file for a single header, - for stdout (default: bindings.n)."
+    )
+    parser.add_argument(
+        "--output-dir", default=".",
+        help="Directory for <header>.n outputs when binding several headers (default: .)."
     )
-    parser.add_argument("header", help="Path to the C header file to parse.")
     parser.add_argument(
-        "-o", "--output", default="bindings.n",
-        help="Path to the output Nature file (default: bindings.n)."
+        "--manifest",
+        help="TOML file listing headers to bind (see load_manifest for the format)."
+    )
+    parser.add_argument(
+        "-j", "--jobs", type=int, default=os.cpu_count() or 1,
+        help="Number of headers to process in parallel (default: CPU count)."
+    )
+    parser.add_argument(
+        "--macro-jobs", type=int, default=1, metavar="N",
+        help="Worker processes sharing the clang evaluation of macros the fast path cannot fold, "
+             "each parsing against the header's precompiled header (default: 1, in process; 0: CPU count). "
+             "Output is identical either way."
+    )
+    parser.add_argument(
+        "--umbrella-jobs", type=int, default=1, metavar="N",
+        help="Parse each header an umbrella header (one holding only #include lines) includes as a shard "
+             "of its own, N in parallel, and merge the results (default: 1, one parse; 0: CPU count). "
+             "Other headers are parsed whole."
     )
     parser.add_argument(
         "-I", dest="include_dirs", action="append", default=[],
         help="Add a directory to the Clang include path (e.g., -I/usr/include)."
     )
+    parser.add_argument(
+        "--cache-dir", default=os.getenv("NATUREBINDGEN_CACHE_DIR"),
+        help="Directory for cached translation units and macro PCHs "
+             "(default: $NATUREBINDGEN_CACHE_DIR, caching is off when unset)."
+    )
+    parser.add_argument(
+        "--incremental", action="store_true",
+        help="Reuse unchanged functions and macro constants from the previous run (requires --cache-dir)."
+    )
+    parser.add_argument(
+        "--log-level", choices=LOG_LEVELS, default="info",
+        help="Diagnostics printed to stderr (default: info)."
+    )
+    parser.add_argument(
+        "-v", "--verbose", action="store_const", const="debug", dest="log_level",
+        help="Shorthand for --log-level debug."
+    )
+    parser.add_argument(
+        "--timings", action="store_true",
+        help="Report time per phase, event counts and peak memory for each header."
+    )
+    filtering = parser.add_argument_group(
+        "declaration filters",
+        "Bind only some declarations. Types used by kept functions and records are "
+        "pulled in automatically unless denied; options can be repeated."
+    )
+    filtering.add_argument("--allow", action="append", default=[], metavar="REGEX",
+                           help="Keep declarations whose whole name matches.")
+    filtering.add_argument("--deny", action="append", default=[], metavar="REGEX",
+                           help="Drop declarations whose whole name matches.")
+    filtering.add_argument("--allow-prefix", action="append", default=[], metavar="PREFIX")
+    filtering.add_argument("--deny-prefix", action="append", default=[], metavar="PREFIX")
+    filtering.add_argument("--allow-file", action="append", default=[], metavar="GLOB",
+                           help="Keep declarations from matching source files (path or base name).")
+    filtering.add_argument("--deny-file", action="append", default=[], metavar="GLOB",
+                           help="Skip matching source files entirely.")
+    parser.add_argument(
+        "--split", action="store_true",
+        help="Write one module per originating header next to the output, plus a shared "
+             "<output stem>_types module for records used across headers."
+    )
+    parser.add_argument(
+        "--used-by", action="extend", nargs="+", default=[], metavar="SOURCE",
+        help="Only emit what these Nature sources reference through their import of the "
+             "output module (matched by file stem), plus the types that needs."
+    )
+    parser.add_argument(
+        "--consts", action="store_true",
+        help="Emit macros folded to number literals, and enum members, as compile-time `const`s "
+             "(with each enum as a type alias of its underlying integer type) instead of globals."
+    )
+    parser.add_argument(
+        "--variadic-overload", action="append", type=overload_spec, default=[], metavar="FUNCTION:TYPES",
+        help="Also bind variadic FUNCTION with fixed trailing arguments of TYPES (comma separated, like "
+             "TraceLog:i32,f64) as FUNCTION_i32_f64, linking to the same symbol without boxing to any. Repeatable."
+    )
+    parser.add_argument(
+        "--printf-overloads", action="store_true",
+        help="Also bind every printf-style variadic function with one i32, i64 or anyptr argument."
+    )
+    parser.add_argument(
+        "--profile-bindings", action="store_true",
+        help="Bind each non-variadic function under a private name behind a wrapper that counts calls and "
+             "sums their time; bindings_profile_dump(n) (<module>_profile_dump with --split) prints the n most expensive."
+    )
+    parser.add_argument(
+        "--link", action="append", type=Library.from_spec, default=[], metavar="[NAME=]LIBRARY",
+        help="A static or shared library the bindings link against (name defaults to the file's, "
+             "libraylib_linux_amd64.a -> raylib). Functions none of them export are dropped. Repeatable."
+    )
+    parser.add_argument(
+        "--keep-unexported", action="store_true",
+        help="With --link, only warn about functions the libraries do not export instead of dropping them."
+    )
+    parser.add_argument(
+        "--package-toml", nargs="?", const="package.toml", default=None, metavar="PATH",
+        help="Rewrite the [links] table of this package.toml (default: ./package.toml) from the --link "
+             "libraries, one entry per platform found in them."
+    )
+    parser.add_argument(
+        "--dump-model", nargs="?", const="", default=None, metavar="PATH",
+        help="Save the collected model, before --used-by pruning, as JSON (.gz to compress; "
+             "default path: <output>.model.json)."
+    )
+    parser.add_argument(
+        "--from-model", metavar="PATH",
+        help="Emit bindings from a saved model instead of parsing; works without libclang via model.py."
+    )
+    parser.add_argument(
+        "--depfile", nargs="?", const="", default=None, metavar="PATH",
+        help="Write a Makefile-style list of every file the header pulled in "
+             "(default path: <output>.d; a path is only allowed for a single header)."
+    )
+    parser.add_argument(
+        "--check", action="store_true",
+        help="Skip headers whose inputs, options and output are unchanged since the last run, without parsing."
+    )
+    parser.add_argument(
+        "--serve", action="store_true",
+        help="Run as a warm server answering JSON-RPC requests on stdin (see server.py)."
+    )
 
     args = parser.parse_args()
+    configure_logging(args.log_level)
+    if args.serve:
+        from server import serve
+        serve(args)
+        return
+    if args.output == STDOUT:
+        # Nothing but the bindings may reach stdout, and there is no file to stamp or name others after
+        if args.split or args.check or args.depfile is not None:
+            parser.error("-o - cannot be combined with --split, --check or --depfile")
+        if args.dump_model == "":
+            parser.error("with -o -, --dump-model needs an explicit path")
+    # Progress and diagnostics, kept off stdout when the bindings go there
+    report = sys.stderr if args.output == STDOUT else sys.stdout
+    if args.package_toml and not args.link:
+        parser.error("--package-toml requires --link")
+    index = SymbolIndex(args.cache_dir)
+    for library in args.link:
+        try:
+            index.load(library)
+        except (OSError, ValueError) as e:
+            parser.error(f"cannot read symbols of {library.path}: {e}")
+    if args.package_toml:
+        try:
+            if update_package_toml(args.package_toml, args.link):
+                print(f"Updated the [links] table of {args.package_toml}", file=report)
+        except OSError as e:
+            parser.error(f"cannot write {args.package_toml}: {e}")
+    if args.from_model:
+        try:
+            model = BindingModel.load(args.from_model)
+        except (OSError, ValueError, KeyError) as e:
+            parser.error(f"cannot load model {args.from_model}: {e}")
+        output = args.output or "bindings.n"
+        for line in verify_exports(model, args.link, args.keep_unexported):
+            print(line, file=report)
+        if args.used_by:
+            prune_to_sources(model, output, args.used_by)
+        outputs, _ = write_bindings(model, output, args.split, EmitOptions.from_args(args))
+        if output != STDOUT:
+            print(f"Successfully generated Nature bindings at: {', '.join(outputs)}")
+        return
+    if args.incremental and not args.cache_dir:
+        parser.error("--incremental requires --cache-dir")
+    if args.macro_jobs <= 0:
+        args.macro_jobs = os.cpu_count() or 1
+    if args.umbrella_jobs <= 0:
+        args.umbrella_jobs = os.cpu_count() or 1
+    if not args.headers and not args.manifest:
+        parser.error("no header given (pass header paths or --manifest)")
+    if args.output and (len(args.headers) > 1 or args.manifest):
+        parser.error("-o/--output only applies to a single header; use --output-dir")
+    if args.depfile and (len(args.headers) > 1 or args.manifest):
+        parser.error("a --depfile path only applies to a single header; use --depfile alone for <output>.d")
+    if args.dump_model and (len(args.headers) > 1 or args.manifest):
+        parser.error("a --dump-model path only applies to a single header; use --dump-model alone")
 
 
     clang_args = [f"-I{d}" for d in args.include_dirs]
-
-    generator = BindingGenerator()
     try:
-        generator.parse_header(args.header, clang_args)
-
-        print("\n--- Parsing Summary ---")
-        print(f"Structs: {len(generator.structs)}, Unions: {len(generator.unions)}, Enums: {len(generator.enums)}")
-        print(f"Functions: {len(generator.functions)}, Constants: {len(generator.constants)}, Typedefs: {len(generator.typedefs)}")
-        print("-----------------------")
-
-        output_code = generator.generate_bindings()
-
-        with open(args.output, "w") as f:
-            f.write(output_code)
-
-        print(f"\nSuccessfully generated Nature bindings at: {args.output}")
+        decl_filter = DeclFilter.from_rules(vars(args))
+    except re.error as e:
+        parser.error(f"invalid filter regex: {e}")
+
+    jobs: List[Job] = []
+    if args.manifest:
+        try:
+            jobs.extend(load_manifest(args.manifest, args.include_dirs, decl_filter))
+        except argparse.ArgumentTypeError as e:
+            parser.error(f"{args.manifest}: {e}")
+    if len(args.headers) == 1 and not args.manifest:
+        jobs.append(Job(header=args.headers[0], output=args.output or "bindings.n", clang_args=clang_args,
+                        decl_filter=decl_filter))
+    else:
+        for header in args.headers:
+            stem = os.path.splitext(os.path.basename(header))[0]
+            jobs.append(Job(header=header, output=os.path.join(args.output_dir, f"{stem}.n"), clang_args=clang_args,
+                            decl_filter=decl_filter))
+
+    for job in jobs:
+        job.used_by = job.used_by or args.used_by
+        job.split = job.split or args.split
+        job.links = job.links or args.link
+        job.keep_unexported = job.keep_unexported or args.keep_unexported
+        job.emit.consts = job.emit.consts or args.consts
+        job.emit.printf_overloads = job.emit.printf_overloads or args.printf_overloads
+        job.emit.profile = job.emit.profile or args.profile_bindings
+        for name, arg_types in args.variadic_overload:
+            job.emit.add_overload(name, arg_types)
+    if args.dump_model is not None:
+        for job in jobs:
+            job.dump_model = args.dump_model or f"{job.output}.model.json"
+    if args.depfile is not None:
+        for job in jobs:
+            job.depfile = job.depfile or args.depfile or f"{job.output}.d"
+
+    outputs = [job.output for job in jobs]
+    if len(set(outputs)) != len(outputs):
+        parser.error("several headers would write the same output file")
+
+    failed = False
+    if len(jobs) == 1 or args.jobs <= 1:
+        for job in jobs:
+            try:
+                print("\n" + run_job(job, args), file=report)
+            except (FileNotFoundError, RuntimeError) as e:
+                log.error("An error occurred in %s: %s", job.header, e)
+                failed = True
+    else:
+        from concurrent.futures import ProcessPoolExecutor
+        # Each worker owns its own libclang Index and generator; they only share the on-disk cache
+        with ProcessPoolExecutor(max_workers=min(args.jobs, len(jobs)),
+                                 initializer=configure_logging, initargs=(args.log_level,)) as pool:
+            futures = [(job, pool.submit(run_job, job, args)) for job in jobs]
+            for job, future in futures:
+                try:
+                    print("\n" + future.result())
+                except (FileNotFoundError, RuntimeError) as e:
+                    log.error("An error occurred in %s: %s", job.header, e)
+                    failed = True
 
-    except (FileNotFoundError, RuntimeError) as e:
-        print(f"An error occurred: {e}", file=sys.stderr)
+    if failed:
         sys.exit(1)
 
 if __name__ == "__main__":
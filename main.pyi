@@ -1,18 +1,47 @@
-from out_types import Constant, Enum, Function, Struct, Union, UnnamedObject
+import argparse
+from clang.cindex import Index, TranslationUnit
 from textwrap import dedent as dedent
+from decl_cache import DeclCache
+from filters import DeclFilter
+from model import BindingModel, EmitOptions
+from shards import Shard
+from symbols import Library
+from tu_cache import TUCache
 
-class BindingGenerator:
-    structs: dict[str, Struct]
-    unions: dict[str, Union]
-    enums: dict[str, Enum]
-    functions: dict[str, Function]
-    constants: dict[str, Constant]
-    typedefs: dict[str, str]
-    union_sizes: dict[str, int]
-    clang_to_contextual: dict[UnnamedObject, str]
+def union_type_name(size: int) -> str: ...
+
+class BindingGenerator(BindingModel):
+    tu_cache: TUCache | None
+    decl_cache: DeclCache | None
+    decl_filter: DeclFilter | None
+    macro_jobs: int
+    shard_files: set[str]
+    decl_usrs: dict[tuple[str, str], str] | None
     reserved_keywords: set[str]
-    def __init__(self) -> None: ...
-    def parse_header(self, header_path: str, c_args: list[str] | None = None): ...
-    def generate_bindings(self) -> str: ...
+    translated: list[str]
+    untranslated: dict[str, str]
+    def __init__(self, tu_cache: TUCache | None = None, decl_cache: DeclCache | None = None, decl_filter: DeclFilter | None = None, macro_jobs: int = 1) -> None: ...
+    def parse_header(self, header_path: str, c_args: list[str] | None = None) -> TranslationUnit: ...
+    def parse_translation_unit(self, header_path: str, c_args: list[str] | None = None, index: Index | None = None) -> TranslationUnit: ...
+    def collect(self, tu: TranslationUnit, header_path: str, c_args: list[str] | None = None): ...
+
+class Job:
+    header: str
+    output: str
+    clang_args: list[str]
+    depfile: str | None = ...
+    decl_filter: DeclFilter | None = ...
+    used_by: list[str] = ...
+    split: bool = ...
+    dump_model: str | None = ...
+    emit: EmitOptions = ...
+    links: list[Library] = ...
+    keep_unexported: bool = ...
+    def __init__(self, header: str, output: str, clang_args: list[str], depfile: str | None = None, decl_filter: DeclFilter | None = None, used_by: list[str] = ..., split: bool = False, dump_model: str | None = None, emit: EmitOptions = ..., links: list[Library] = ..., keep_unexported: bool = False) -> None: ...
+    def settings(self) -> list[str]: ...
 
+def collect_shard(shard: Shard, clang_args: list[str], decl_filter: DeclFilter | None, cache_dir: str | None, incremental: bool, shard_files: list[str], log_level: str) -> dict: ...
+def parse_umbrella(generator: BindingGenerator, job: Job, options: argparse.Namespace) -> tuple[list[str], list[str]] | None: ...
+def run_job(job: Job, options: argparse.Namespace) -> str: ...
+def load_manifest(path: str, include_dirs: list[str], decl_filter: DeclFilter | None = None) -> list[Job]: ...
 def main() -> None: ...
@@ -0,0 +1,644 @@
+"""
+The binding model and everything that runs on it alone: emission, usage
+pruning and the on-disk IR. Nothing here needs libclang, so a model dumped
+with `main.py --dump-model` can be turned into bindings on a machine without
+it:
+
+    python3 model.py bindings.model.json -o bindings.n [--split] [--used-by main.n]
+"""
+import argparse
+import dataclasses
+import gzip
+import io
+import json
+import os
+import re
+import sys
+from typing import Any, Dict, List, Optional, Set, TextIO
+
+from out_types import (Constant, Enum, EnumMember, Function, Struct, StructField,
+                       Union, UnnamedObject)
+from depfile import ChangedFile, write_if_changed
+from instrument import configure_logging, log, timings
+from layout import Alignments, accessors, plan_layout, size_check
+from profiling import profiled, table as profile_table, wrapper
+from split import Module, plan_modules
+from usage import find_references, type_names
+
+# Bump when the IR layout changes
+MODEL_VERSION = 1
+
+# Union storage element by alignment
+_UNION_ELEMENTS = {1: "u8", 2: "u16", 4: "u32", 8: "u64"}
+_NON_IDENT_RE = re.compile(r"\W+")
+_IDENT_RE = re.compile(r"[A-Za-z_]\w*")
+_GET_SET_RE = re.compile(r"_[gs]et_")
+# Folded integer and floating literals, which --consts can make compile-time constants
+_NUMBER_RE = re.compile(r"-?(?:0[xX][0-9a-fA-F]+|\d+(?:\.\d*)?(?:[eE][+-]?\d+)?|\.\d+(?:[eE][+-]?\d+)?)")
+# Output path that writes the bindings to stdout
+STDOUT = "-"
+# Name of the generated function comparing Nature record sizes with C's
+LAYOUT_CHECK = "layout_check"
+# C's default argument promotions: what a variadic callee actually reads
+_PROMOTED = {"bool": "i32", "i8": "i32", "u8": "i32", "i16": "i32", "u16": "i32", "f32": "f64"}
+_VARIADIC_TYPE_RE = re.compile(r"[iu](?:8|16|32|64)|f32|f64|bool|int|uint|float|anyptr|rawptr<\w+>")
+# Overloads --printf-overloads adds: one argument of each register class that printf
+# callees read the same way through a fixed prototype (see edge_cases.md)
+PRINTF_OVERLOADS = (("i32",), ("i64",), ("anyptr",))
+
+
+def _literal_const(name: str, value: str, ctype: str) -> str:
+    """A --consts constant, cast to ctype unless that is what Nature infers for the bare literal."""
+    is_float = not value.lstrip("-").lower().startswith("0x") and any(c in value for c in ".eE")
+    if ctype == ("float" if is_float else "int"):
+        return f"const {name} = {value}"
+    return f"const {name} = {value} as {ctype}"
+
+
+def _named_enum(enum: Enum) -> bool:
+    """Whether an enum has a C name to alias, not a spelling libclang made up for an anonymous one."""
+    return bool(_IDENT_RE.fullmatch(enum.name)) and "anonymous" not in enum.name and "unnamed" not in enum.name
+
+
+def _union_element_align(group: List[Union]) -> int:
+    """Alignment of the storage element of the unions in group: C's, as far as an array of u8 to u64 can hold it."""
+    align = min(max((u.align or 1 for u in group), default=1), 8)
+    return 1 if group[0].size % align else align
+
+
+def _unions_by_name(unions: List[Union]) -> Dict[str, List[Union]]:
+    by_name: Dict[str, List[Union]] = {}
+    for union in unions:
+        by_name.setdefault(union.name, []).append(union)
+    return by_name
+
+
+def _union_accessors(group: List[Union]) -> List[tuple[str, str]]:
+    """
+    (accessor suffix, Nature type) for every member of the unions in group,
+    without duplicates. A member name that appears with different types is
+    suffixed with its type, like get_value_i32 and get_value_f64.
+    """
+    types: Dict[str, List[str]] = {}
+    for union in group:
+        for f in union.fields:
+            seen = types.setdefault(f.name, [])
+            if f.ntype not in seen:
+                seen.append(f.ntype)
+    accessors = []
+    for field_name, ntypes in types.items():
+        for ntype in ntypes:
+            if len(ntypes) == 1:
+                accessors.append((field_name, ntype))
+            else:
+                accessors.append((f"{field_name}_{_NON_IDENT_RE.sub('_', ntype).strip('_')}", ntype))
+    return accessors
+
+
+def overload_spec(spec: str) -> tuple[str, tuple[str, ...]]:
+    """Parse a --variadic-overload value, `Name:i32,f64`, as argparse type."""
+    name, sep, types = spec.partition(":")
+    arg_types = tuple(t.strip() for t in types.split(",") if t.strip())
+    if not sep or not name.isidentifier() or not arg_types:
+        raise argparse.ArgumentTypeError(f"expected FUNCTION:TYPE[,TYPE...], got {spec!r}")
+    for t in arg_types:
+        if not _VARIADIC_TYPE_RE.fullmatch(t):
+            raise argparse.ArgumentTypeError(f"{t!r} cannot be passed through C varargs")
+    return name, arg_types
+
+
+def _overload_name(name: str, arg_types: tuple[str, ...]) -> str:
+    return "_".join([name] + [_NON_IDENT_RE.sub("_", t).strip("_") for t in arg_types])
+
+
+@dataclasses.dataclass
+class EmitOptions:
+    """Choices that change the emitted text but not the model."""
+    consts: bool = False  # Literal constants and enum members as `const` instead of initialized globals
+    # Function name -> argument type lists to bind variadic functions with as well, besides ...[any]
+    variadic_overloads: Dict[str, List[tuple[str, ...]]] = dataclasses.field(default_factory=dict)
+    printf_overloads: bool = False  # PRINTF_OVERLOADS for every function with a printf-style format
+    profile: bool = False  # Wrap linked functions to count calls and time them (see profiling.py)
+
+    @classmethod
+    def from_args(cls, args: argparse.Namespace) -> "EmitOptions":
+        options = cls(consts=getattr(args, "consts", False), printf_overloads=getattr(args, "printf_overloads", False),
+                      profile=getattr(args, "profile_bindings", False))
+        for name, arg_types in getattr(args, "variadic_overload", None) or ():
+            options.add_overload(name, arg_types)
+        return options
+
+    def add_overload(self, name: str, arg_types: tuple[str, ...]):
+        overloads = self.variadic_overloads.setdefault(name, [])
+        if tuple(arg_types) not in overloads:
+            overloads.append(tuple(arg_types))
+
+    def overloads(self, func: Function) -> List[tuple[str, ...]]:
+        """The fixed-arity signatures to bind func with, with C's promotions applied."""
+        if not func.is_variadic or func.body is not None:
+            return []
+        wanted = list(self.variadic_overloads.get(func.name, ()))
+        if self.printf_overloads and func.format_arg is not None:
+            wanted += PRINTF_OVERLOADS
+        result = []
+        for arg_types in wanted:
+            promoted = tuple(_PROMOTED.get(t, t) for t in arg_types)
+            if promoted not in result:
+                result.append(promoted)
+        return result
+
+    def settings(self) -> List[str]:
+        """The options as flat strings, for stamps."""
+        settings = ["consts"] if self.consts else []
+        if self.printf_overloads:
+            settings.append("printf_overloads")
+        if self.profile:
+            settings.append("profile")
+        settings += [f"overload={name}:{','.join(t)}" for name in sorted(self.variadic_overloads)
+                     for t in self.variadic_overloads[name]]
+        return settings
+
+
+class BindingModel:
+    """
+    The declarations collected from a header, as BindingGenerator.collect
+    leaves them, plus the tables emission consults.
+    """
+
+    def __init__(self):
+        self.header: Optional[str] = None  # The header the model was collected from
+        self.structs: Dict[str, Struct] = {}
+        self.unions: Dict[str, Union] = {}
+        self.enums: Dict[str, Enum] = {}
+        self.functions: Dict[str, Function] = {}
+        self.constants: Dict[str, Constant] = {}
+        self.typedefs: Dict[str, str] = {}
+        self.union_sizes: Dict[str, int] = {}  # Maps union names to their sizes
+        self.clang_to_contextual: Dict[UnnamedObject, str] = {}  # Anonymous record declaration -> contextual name
+        self.decl_cache = None  # Set by BindingGenerator for --incremental
+        self._decl_keys: Dict[tuple[str, str], str] = {}  # (kind, name) -> decl cache key
+        self._layout_alignments: Optional[Alignments] = None
+
+    def to_dict(self) -> Dict[str, Any]:
+        asdict = dataclasses.asdict
+        return {
+            "version": MODEL_VERSION,
+            "header": self.header,
+            "structs": [asdict(s) for s in self.structs.values()],
+            "unions": {name: asdict(u) for name, u in self.unions.items()},
+            "enums": [asdict(e) for e in self.enums.values()],
+            "functions": [asdict(f) for f in self.functions.values()],
+            "constants": [asdict(c) for c in self.constants.values()],
+            "typedefs": self.typedefs,
+            "union_sizes": self.union_sizes,
+            "anonymous": [[k.is_union, k.file, k.location, name] for k, name in self.clang_to_contextual.items()],
+        }
+
+    @classmethod
+    def from_dict(cls, data: Dict[str, Any]) -> "BindingModel":
+        if data.get("version") != MODEL_VERSION:
+            raise ValueError(f"unsupported model version {data.get('version')} (expected {MODEL_VERSION})")
+        fields = lambda d: [StructField(**f) for f in d.pop("fields")]
+        model = cls()
+        model.header = data.get("header")
+        for d in data["structs"]:
+            struct = Struct(fields=fields(d), **d)
+            model.structs[struct.name] = struct
+        for name, d in data["unions"].items():
+            model.unions[name] = Union(fields=fields(d), **d)
+        for d in data["enums"]:
+            model.enums[d["name"]] = Enum(name=d["name"], members=[EnumMember(**m) for m in d["members"]],
+                                          file=d.get("file"), ntype=d.get("ntype", "int"))
+        for d in data["functions"]:
+            model.functions[d["name"]] = Function.from_dict(d)
+        for d in data["constants"]:
+            model.constants[d["name"]] = Constant.from_dict(d)
+        model.typedefs = dict(data["typedefs"])
+        model.union_sizes = dict(data["union_sizes"])
+        model.clang_to_contextual = {
+            UnnamedObject(is_union=u, file=f, location=loc): name for u, f, loc, name in data["anonymous"]
+        }
+        return model
+
+    def save(self, path: str):
+        """Write the model as JSON, gzipped when path ends in .gz."""
+        text = json.dumps(self.to_dict(), separators=(",", ":"))
+        if path.endswith(".gz"):
+            with gzip.open(path, "wt", encoding="utf-8") as f:
+                f.write(text)
+        else:
+            write_if_changed(path, text)
+
+    @classmethod
+    def load(cls, path: str) -> "BindingModel":
+        opener = gzip.open if path.endswith(".gz") else open
+        with opener(path, "rt", encoding="utf-8") as f:
+            return cls.from_dict(json.load(f))
+
+    def prune_unused(self, used: Set[str]):
+        """
+        Keep only the functions, constants and enum members named in used
+        (as emitted), the records used names directly, and every record and
+        typedef those reach through parameter, return, field and constant
+        types. Typedefs are not emitted themselves but can name records.
+        """
+        before = len(self.functions) + len(self.constants) + len(self.structs) + len(self.unions)
+        # Translated bodies call functions and read constants of their own
+        used = set(used)
+        # Typed overloads of a variadic function are named <function>_<types>
+        for name in list(used):
+            head = name
+            while "_" in head and head not in self.functions:
+                head = head.rsplit("_", 1)[0]
+            if head != name and head in self.functions and self.functions[head].is_variadic:
+                used.add(head)
+        pending_bodies = [n for n in used if n in self.functions]
+        while pending_bodies:
+            func = self.functions[pending_bodies.pop()]
+            for name in (n for line in func.body or () for n in type_names(line)):
+                if name not in used:
+                    used.add(name)
+                    if name in self.functions:
+                        pending_bodies.append(name)
+        self.functions = {n: f for n, f in self.functions.items() if n in used}
+        self.constants = {n: c for n, c in self.constants.items() if n in used}
+        for enum in self.enums.values():
+            enum.members = [m for m in enum.members if f"{enum.name}_{m.name}" in used]
+        self.enums = {n: e for n, e in self.enums.items() if e.members}
+
+        unions_by_name = _unions_by_name(list(self.unions.values()))
+        # Union helpers are emitted as new<UnionName> and <UnionName>_get_/_set_<member>,
+        # accessors for packed fields and bitfields as <Struct>_get_/_set_<field>
+        accessor_re = re.compile(r"(?:new)?(Union_\w+?_bytes)(?:_[gs]et_\w+)?")
+
+        def record_of(name: str) -> str:
+            m = accessor_re.fullmatch(name)
+            if m and m[1] in unions_by_name:
+                return m[1]
+            for m in _GET_SET_RE.finditer(name):
+                if name[:m.start()] in self.structs:
+                    return name[:m.start()]
+            return name
+
+        pending = [record_of(n) for n in used]
+        for func in self.functions.values():
+            pending.extend(type_names(func.return_type))
+            for param in func.parameters:
+                pending.extend(type_names(param.ntype))
+            for line in func.body or ():
+                pending.extend(type_names(line))
+        for const in self.constants.values():
+            pending.extend(type_names(const.ctype))
+
+        reached: Set[str] = set()
+        while pending:
+            name = pending.pop()
+            if name in reached:
+                continue
+            reached.add(name)
+            if name in self.structs:
+                for f in self.structs[name].fields:
+                    pending.extend(type_names(f.ntype))
+            if name in self.typedefs:
+                pending.extend(type_names(self.typedefs[name]))
+            for union in unions_by_name.get(name, ()):
+                for f in union.fields:
+                    pending.extend(type_names(f.ntype))
+
+        self.structs = {n: s for n, s in self.structs.items() if n in reached}
+        self.unions = {n: u for n, u in self.unions.items() if u.name in reached}
+        after = len(self.functions) + len(self.constants) + len(self.structs) + len(self.unions)
+        timings.count("bindings pruned", before - after)
+
+    def _spliced(self, kind: str, name: str, emit) -> str:
+        """Generated text for a declaration, reusing the incremental cache when it is unchanged."""
+        key = self._decl_keys.get((kind, name))
+        if self.decl_cache is None or key is None:
+            return emit()
+        text = self.decl_cache.text(key)
+        if text is None:
+            text = emit()
+            self.decl_cache.set_text(key, text)
+        return text
+
+    def _emit_constant(self, const: Constant, module: Optional[Module] = None) -> str:
+        if module is not None:
+            return f"{module.qualify(const.ctype)} {const.name} = {module.qualify_value(const.value)}"
+        return f"{const.ctype} {const.name} = {const.value}"
+
+    def _emit_function(self, func: Function, module: Optional[Module] = None) -> str:
+        qualify = module.qualify if module is not None else str
+        if func.body is not None:
+            # Translated from a macro or static inline body: native code, nothing to link
+            generics = f"<{', '.join(func.type_params)}>" if func.type_params else ""
+            param_list = ", ".join(f"{qualify(p.ntype)} {p.name}" for p in func.parameters)
+            return_type = f":{qualify(func.return_type)}" if func.return_type != "void" else ""
+            body = "".join(f"    {qualify(line)}\n" for line in func.body)
+            return f"fn {func.name}{generics}({param_list}){return_type} {{\n{body}}}\n"
+        lines = []
+        # Add linkid tag for C interop
+        lines.append(f'#linkid {func.c_name}')
+
+        param_list = ", ".join(f"{qualify(p.ntype)} {p.name}" for p in func.parameters)
+
+        # Handle variadic functions according to Nature syntax
+        if func.is_variadic:
+            if param_list: param_list += ", "
+            # Assuming variadic params are ints; this could be made configurable
+            param_list += "...[any] args"
+
+        return_type = f":{qualify(func.return_type)}" if func.return_type != "void" else ""
+        lines.append(f"fn {func.name}({param_list}){return_type}\n")
+        return "\n".join(lines)
+
+    def _emit_overloads(self, func: Function, signatures: List[tuple[str, ...]], module: Optional[Module] = None) -> str:
+        """
+        Extra declarations of variadic func with fixed trailing arguments,
+        all linking to the same symbol, so calls pass the values directly
+        instead of boxing each one as any.
+        """
+        qualify = module.qualify if module is not None else str
+        fixed = [f"{qualify(p.ntype)} {p.name}" for p in func.parameters]
+        return_type = f":{qualify(func.return_type)}" if func.return_type != "void" else ""
+        lines = []
+        for arg_types in signatures:
+            name = _overload_name(func.name, arg_types)
+            if name in self.functions:
+                log.warning("Not emitting overload %s: a C function has that name", name)
+                continue
+            params = fixed + [f"{qualify(t)} arg{i}" for i, t in enumerate(arg_types)]
+            lines.append(f"#linkid {func.c_name}")
+            lines.append(f"fn {name}({', '.join(params)}){return_type}\n")
+        return "\n".join(lines)
+
+    def _emit_union(self, name: str, group: List[Union], qualify=str) -> str:
+        """
+        The storage type for the unions in group (which share name) plus a
+        get/set pair per member that reads or writes the storage in place
+        through a rawptr, so event loops never copy the union. The storage is
+        an array of the widest element the C alignment allows, keeping both
+        the accessors and struct fields holding the union aligned as in C.
+        """
+        size = group[0].size
+        align = _union_element_align(group)
+        elem = _UNION_ELEMENTS[align]
+        zeros = ",".join(["zero"] * (size // align))
+        lines = [group[0].to_nature(elem, size // align)]
+        # Constructor writing a typed value into zeroed storage (used by macro initializers)
+        lines.append(f"fn new{name}<T>(T value):{name} {{")
+        lines.append(f"    {elem} zero = 0 as {elem}")
+        lines.append(f"    {name} result = [{zeros}]")
+        lines.append(f"    rawptr<{name}> p = &result")
+        lines.append(f"    *(p as anyptr as rawptr<T>) = value")
+        lines.append("    return result")
+        lines.append("}")
+
+        for accessor, ntype in _union_accessors(group):
+            ntype = qualify(ntype)
+            lines.append("")
+            lines.append(f"fn {name}_get_{accessor}(rawptr<{name}> u):{ntype} {{")
+            lines.append(f"    return *(u as anyptr as rawptr<{ntype}>)")
+            lines.append("}")
+            lines.append(f"fn {name}_set_{accessor}(rawptr<{name}> u, {ntype} value) {{")
+            lines.append(f"    *(u as anyptr as rawptr<{ntype}>) = value")
+            lines.append("}")
+        lines.append("")
+        return "\n".join(lines)
+
+    def _alignments(self) -> Alignments:
+        """Nature alignments of the model's field types, built once per emission (see emit_bindings)."""
+        if self._layout_alignments is None:
+            self._layout_alignments = Alignments(
+                {s.name: s for s in self.structs.values()},
+                {name: _union_element_align(group) for name, group in _unions_by_name(list(self.unions.values())).items()})
+        return self._layout_alignments
+
+    def _emit_struct(self, struct: Struct, qualify=str) -> str:
+        """
+        The struct with its C layout (see layout.plan_layout): explicit
+        padding, and raw bytes plus accessors for packed fields and
+        bitfields. Records without a recorded layout keep their fields as
+        declared.
+        """
+        slots = plan_layout(struct, self._alignments())
+        lines = [f"type {struct.name} = struct {{"]
+        if slots is None:
+            lines += [f"    {qualify(f.ntype)} {f.name}" for f in struct.fields]
+        else:
+            lines += [f"    {qualify(slot.ntype)} {slot.name}" for slot in slots]
+        lines.append("}")
+        lines.append("")
+        for slot in slots or ():
+            if slot.kind in ("bytes", "bits"):
+                lines += accessors(struct.name, slot, qualify)
+        if lines[-1] != "":
+            lines.append("")
+        return "\n".join(lines)
+
+    def generate_bindings(self, module: Optional[Module] = None, options: Optional[EmitOptions] = None) -> str:
+        """
+        Generates the full Nature language binding code as a string, or with
+        module (see split.plan_modules) only that module's declarations.
+        """
+        out = io.StringIO()
+        self.emit_bindings(out, module, options)
+        return out.getvalue()
+
+    def emit_bindings(self, out: TextIO, module: Optional[Module] = None, options: Optional[EmitOptions] = None) -> int:
+        """
+        Writes what generate_bindings returns to out as it is generated, one
+        declaration at a time, so only the declaration being emitted is held
+        in memory. Returns the number of characters written.
+        """
+        options = options or EmitOptions()
+        self._layout_alignments = None  # The model may have been pruned or renamed since the last emission
+        if module is None:
+            constants = sorted(self.constants.values(), key=lambda c: c.name)
+            enums = list(self.enums.values())
+            unions = list(self.unions.values())
+            structs = list(self.structs.values())
+            functions = list(self.functions.values())
+            qualify = str
+        else:
+            constants, enums, unions = module.constants, module.enums, module.unions
+            structs, functions = module.structs, module.functions
+            qualify = module.qualify
+        # Cached text is unqualified, so it only fits whole-model output
+        spliced = self._spliced if module is None else lambda kind, name, emit: emit()
+        writer = _SectionWriter(out)
+        write = writer.item
+
+        def emit_constants_and_enums():
+            if constants:
+                write("// Constants from Macros")
+                # Simple alphabetical sort is sufficient for most cases
+                for const in constants:
+                    if options.consts and _NUMBER_RE.fullmatch(const.value):
+                        # Folded to a literal: an immediate at every use instead of a global load
+                        write(_literal_const(const.name, const.value, const.ctype))
+                    else:
+                        write(spliced("const", const.name, lambda: self._emit_constant(const, module)))
+
+            if enums:
+                write("\n// Enum Constants")
+                for enum in enums:
+                    if options.consts:
+                        if _named_enum(enum):
+                            write(f"type {enum.name} = {enum.ntype}")
+                        for member in enum.members:
+                            write(_literal_const(f"{enum.name}_{member.name}", str(member.value), enum.ntype))
+                        continue
+                    for member in enum.members:
+                        write(f"int {enum.name}_{member.name} = {member.value}")
+
+        def emit_records():
+            # Generate unions first, as they are simple type aliases
+            if unions:
+                write("\n// Union Definitions (as byte arrays)\n")
+                # Each size-based union type is defined once, with the fields of every union of that size
+                for name, group in _unions_by_name(unions).items():
+                    write(self._emit_union(name, group, qualify))
+            if structs:
+                write("\n// Struct Definitions")
+                for struct in structs:
+                    write(self._emit_struct(struct, qualify))
+
+            # Records whose C size is known, checked against what Nature makes of them
+            sized = [(name, group[0].size) for name, group in _unions_by_name(unions).items()]
+            sized += [(s.name, s.size) for s in structs if s.size is not None]
+            if sized:
+                write(size_check(LAYOUT_CHECK, sized))
+
+        def emit_functions():
+            write("\n// Function Bindings")
+            wrapped = [f.name for f in functions if profiled(f)] if options.profile else []
+            slots = {name: i for i, name in enumerate(wrapped)}
+            prefix = module.name if module is not None else "bindings"
+            if wrapped:
+                write(profile_table(prefix, wrapped))
+            for func in functions:
+                if func.name in slots:
+                    write(wrapper(func, slots[func.name], prefix, qualify))
+                    continue
+                write(spliced("fn", func.name, lambda: self._emit_function(func, module)))
+                signatures = options.overloads(func)
+                if signatures:
+                    write(self._emit_overloads(func, signatures, module))
+
+        # Sections in a fixed order, each one's declarations in model order
+        write("// Generated Nature bindings\n// This file was automatically generated naturebindgen.\n")
+        writer.section()
+        write("".join(f"{line}\n" for line in module.import_lines()) if module is not None else "")
+        for emit_section in (emit_constants_and_enums, emit_records, emit_functions):
+            writer.section()
+            emit_section()
+        return writer.size
+
+
+class _SectionWriter:
+    """
+    Writes sections of items to out exactly as
+    "\n".join(filter(None, ["\n".join(items) for items in sections]))
+    would, without building any of those strings.
+    """
+
+    def __init__(self, out: TextIO):
+        self.out = out
+        self.size = 0  # Characters written
+        self._started = False  # Whether any section wrote text
+        self._items = 0  # Items in the current section
+        self._open = False  # Whether the current section wrote text
+
+    def section(self):
+        self._items = 0
+        self._open = False
+
+    def item(self, text: str):
+        separated = self._items > 0
+        self._items += 1
+        if not separated and not text:
+            return
+        if not self._open:
+            if self._started:
+                self._put("\n")
+            self._open = self._started = True
+        if separated:
+            self._put("\n")
+        self._put(text)
+
+    def _put(self, text: str):
+        self.out.write(text)
+        self.size += len(text)
+
+
+def write_bindings(model: BindingModel, output: str, split: bool = False,
+                   options: Optional[EmitOptions] = None) -> tuple[List[str], bool]:
+    """
+    Emit model to output, or with split one module at a time beside it,
+    streaming every file through a buffer; output "-" is stdout. Returns
+    the files produced and whether any of them changed on disk.
+    """
+    if output == STDOUT:
+        try:
+            timings.count("output bytes", model.emit_bindings(sys.stdout, options=options))
+            sys.stdout.flush()
+        except BrokenPipeError:
+            # The reader stopped early (like `| head`); point stdout at devnull so exiting cannot fail flushing it
+            os.dup2(os.open(os.devnull, os.O_WRONLY), sys.stdout.fileno())
+            log.warning("stdout was closed before the bindings were complete")
+        return [output], True
+    modules = [None] if not split else plan_modules(model, model.header or "", output)
+    outputs, written = [], False
+    # One declaration in memory at a time
+    for module in modules:
+        path = module.path if module is not None else output
+        with ChangedFile(path) as out:
+            timings.count("output bytes", model.emit_bindings(out, module, options))
+        written = out.written or written
+        outputs.append(path)
+    return outputs, written
+
+
+def prune_to_sources(model: BindingModel, output: str, used_by: List[str]):
+    """Apply --used-by: prune model to what the Nature sources use of output's module."""
+    module = os.path.splitext(os.path.basename(output))[0]
+    used = find_references(used_by, module)
+    if used is None:
+        log.warning("None of %s imports %s; keeping every binding", ", ".join(used_by), module)
+    else:
+        model.prune_unused(used)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Generate Nature bindings from a model dumped by main.py --dump-model.")
+    parser.add_argument("model", help="Model file (.json or .json.gz).")
+    parser.add_argument("-o", "--output", default="bindings.n",
+                        help="Output Nature file, - for stdout (default: bindings.n).")
+    parser.add_argument("--split", action="store_true", help="Write one module per originating header (see split.py).")
+    parser.add_argument("--used-by", action="extend", nargs="+", default=[], metavar="SOURCE",
+                        help="Only emit what these Nature sources reference.")
+    parser.add_argument("--consts", action="store_true",
+                        help="Emit literal constants and enum members as compile-time constants.")
+    parser.add_argument("--variadic-overload", action="append", type=overload_spec, default=[],
+                        metavar="FUNCTION:TYPES", help="Also bind a variadic function with these trailing argument types.")
+    parser.add_argument("--printf-overloads", action="store_true",
+                        help="Also bind printf-style functions with one i32, i64 or anyptr argument.")
+    parser.add_argument("--profile-bindings", action="store_true",
+                        help="Wrap bound functions to count calls and time them (see profiling.py).")
+    args = parser.parse_args()
+    if args.output == STDOUT and args.split:
+        parser.error("--split writes several files and cannot write to stdout")
+    configure_logging()
+    try:
+        model = BindingModel.load(args.model)
+    except (OSError, ValueError, KeyError) as e:
+        sys.exit(f"Cannot load model {args.model}: {e}")
+    if args.used_by:
+        prune_to_sources(model, args.output, args.used_by)
+    outputs, _ = write_bindings(model, args.output, args.split, EmitOptions.from_args(args))
+    if args.output != STDOUT:
+        print(f"Successfully generated Nature bindings at: {', '.join(outputs)}")
+
+
+if __name__ == "__main__":
+    main()
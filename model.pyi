@@ -0,0 +1,50 @@
+import argparse
+from decl_cache import DeclCache
+from out_types import Constant, Enum, Function, Struct, Union, UnnamedObject
+from split import Module
+from typing import Any, TextIO
+
+MODEL_VERSION: int
+STDOUT: str
+LAYOUT_CHECK: str
+PRINTF_OVERLOADS: tuple[tuple[str, ...], ...]
+
+def overload_spec(spec: str) -> tuple[str, tuple[str, ...]]: ...
+
+class EmitOptions:
+    consts: bool
+    variadic_overloads: dict[str, list[tuple[str, ...]]]
+    printf_overloads: bool
+    profile: bool
+    def __init__(self, consts: bool = False, variadic_overloads: dict[str, list[tuple[str, ...]]] = ..., printf_overloads: bool = False, profile: bool = False) -> None: ...
+    @classmethod
+    def from_args(cls, args: argparse.Namespace) -> EmitOptions: ...
+    def add_overload(self, name: str, arg_types: tuple[str, ...]): ...
+    def overloads(self, func: Function) -> list[tuple[str, ...]]: ...
+    def settings(self) -> list[str]: ...
+
+class BindingModel:
+    header: str | None
+    structs: dict[str, Struct]
+    unions: dict[str, Union]
+    enums: dict[str, Enum]
+    functions: dict[str, Function]
+    constants: dict[str, Constant]
+    typedefs: dict[str, str]
+    union_sizes: dict[str, int]
+    clang_to_contextual: dict[UnnamedObject, str]
+    decl_cache: DeclCache | None
+    def __init__(self) -> None: ...
+    def to_dict(self) -> dict[str, Any]: ...
+    @classmethod
+    def from_dict(cls, data: dict[str, Any]) -> BindingModel: ...
+    def save(self, path: str): ...
+    @classmethod
+    def load(cls, path: str) -> BindingModel: ...
+    def prune_unused(self, used: set[str]): ...
+    def generate_bindings(self, module: Module | None = None, options: EmitOptions | None = None) -> str: ...
+    def emit_bindings(self, out: TextIO, module: Module | None = None, options: EmitOptions | None = None) -> int: ...
+
+def write_bindings(model: BindingModel, output: str, split: bool = False, options: EmitOptions | None = None) -> tuple[list[str], bool]: ...
+def prune_to_sources(model: BindingModel, output: str, used_by: list[str]): ...
+def main() -> None: ...
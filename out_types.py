@@ -1,64 +1,99 @@
+import sys
 from dataclasses import dataclass, field
 from typing import List, Optional
 
-@dataclass
+# Models only hold what emission needs (no libclang objects, so the TU can be
+# freed after collection) and use __slots__; type strings are interned since
+# the same few hundred repeat across every field and parameter.
+
+@dataclass(slots=True)
 class Constant:
     name: str
     ctype: str
     value: str
+    file: Optional[str] = None  # Header the macro was defined in
 
     def __hash__(self):
         return hash(self.name)
 
-@dataclass
+    @staticmethod
+    def from_dict(data: dict) -> 'Constant':
+        return Constant(name=data["name"], ctype=data["ctype"], value=data["value"], file=data.get("file"))
+
+@dataclass(slots=True)
 class Parameter:
     name: str
     ntype: str  # Nature type
 
-@dataclass
+    def __post_init__(self):
+        self.ntype = sys.intern(self.ntype)
+
+@dataclass(slots=True)
 class Function:
     name: str
     c_name: str
     return_type: str
     parameters: List[Parameter]
     is_variadic: bool = False
-
-@dataclass
+    format_arg: Optional[int] = None  # Index of the printf-style format parameter of a variadic function
+    file: Optional[str] = None  # Header the function was declared in
+    body: Optional[List[str]] = None  # Nature statements when translated (see translate.py) rather than linked
+    type_params: List[str] = field(default_factory=list)  # For generic translated macros
+
+    @staticmethod
+    def from_dict(data: dict) -> 'Function':
+        return Function(
+            name=data["name"], c_name=data["c_name"], return_type=data["return_type"],
+            parameters=[Parameter(**p) for p in data["parameters"]],
+            is_variadic=data.get("is_variadic", False), format_arg=data.get("format_arg"), file=data.get("file"),
+            body=data.get("body"), type_params=list(data.get("type_params", []))
+        )
+
+@dataclass(slots=True)
 class StructField:
     name: str
     ntype: str
+    offset: Optional[int] = None  # Bit offset in the record, as libclang reports it
+    size: Optional[int] = None  # sizeof the field's type
+    align: Optional[int] = None
+    bit_width: Optional[int] = None  # Set for bitfields
+
+    def __post_init__(self):
+        self.ntype = sys.intern(self.ntype)
 
-@dataclass
+@dataclass(slots=True)
 class Struct:
     name: str
     fields: List[StructField] = field(default_factory=list)
-    cursor: Optional['Cursor'] = None
+    size: Optional[int] = None  # sizeof in bytes, when the record is complete
+    align: Optional[int] = None
+    file: Optional[str] = None  # Header the record was defined in
 
-@dataclass
+@dataclass(slots=True)
 class Union:
     name: str
     size: int
     fields: List[StructField] = field(default_factory=list)
-    cursor: Optional['Cursor'] = None
+    align: Optional[int] = None
+    file: Optional[str] = None
 
-    def to_nature(self) -> str:
-        """Generates Nature code for the union as a type alias to [u8;N]."""
-        from num2words import num2words
-        size_in_words = num2words(self.size)
-        union_type_name = f"Union_{size_in_words}_bytes"
-        return f"type {self.name} = [u8;{self.size}]\n"
+    def to_nature(self, element: str = "u8", count: Optional[int] = None) -> str:
+        """Generates Nature code for the union as a type alias to [element;count] (default [u8;size])."""
+        return f"type {self.name} = [{element};{self.size if count is None else count}]\n"
 
-@dataclass
+@dataclass(slots=True)
 class EnumMember:
     name: str
     value: int
 
-@dataclass
+@dataclass(slots=True)
 class Enum:
     name: str
     members: List[EnumMember] = field(default_factory=list)
+    file: Optional[str] = None
+    ntype: str = "int"  # Nature type of the underlying integer type (cursor.enum_type)
 
-@dataclass
+@dataclass(slots=True)
 class UnnamedObject:
     is_union: bool
     file: str
@@ -89,5 +124,9 @@ class UnnamedObject:
         else:
             return f"(unnamed {struct_or_union} at {self.file}:{self.location})"
 
-# Forward reference for type hints
-from clang.cindex import Cursor
+@dataclass(slots=True)
+class HeaderGuard:
+    """Per-file macro info used to skip include guards."""
+    first_macro: str
+    pragma_once: bool
+    guard: Optional[str] = None  # The first macro when it is a classic #ifndef/#define guard
@@ -1,56 +1,75 @@
-from clang.cindex import Cursor
 from dataclasses import dataclass, field
 
-@dataclass
+@dataclass(slots=True)
 class Constant:
     name: str
     ctype: str
     value: str
+    file: str | None = ...
     def __hash__(self): ...
+    @staticmethod
+    def from_dict(data: dict) -> Constant: ...
 
-@dataclass
+@dataclass(slots=True)
 class Parameter:
     name: str
     ntype: str
+    def __post_init__(self) -> None: ...
 
-@dataclass
+@dataclass(slots=True)
 class Function:
     name: str
     c_name: str
     return_type: str
     parameters: list[Parameter]
     is_variadic: bool = ...
+    format_arg: int | None = ...
+    file: str | None = ...
+    body: list[str] | None = ...
+    type_params: list[str] = field(default_factory=list)
+    @staticmethod
+    def from_dict(data: dict) -> Function: ...
 
-@dataclass
+@dataclass(slots=True)
 class StructField:
     name: str
     ntype: str
+    offset: int | None = ...
+    size: int | None = ...
+    align: int | None = ...
+    bit_width: int | None = ...
+    def __post_init__(self) -> None: ...
 
-@dataclass
+@dataclass(slots=True)
 class Struct:
     name: str
     fields: list[StructField] = field(default_factory=list)
-    cursor: Cursor | None = ...
+    size: int | None = ...
+    align: int | None = ...
+    file: str | None = ...
 
-@dataclass
+@dataclass(slots=True)
 class Union:
     name: str
     size: int
     fields: list[StructField] = field(default_factory=list)
-    cursor: Cursor | None = ...
-    def to_nature(self) -> str: ...
+    align: int | None = ...
+    file: str | None = ...
+    def to_nature(self, element: str = ..., count: int | None = ...) -> str: ...
 
-@dataclass
+@dataclass(slots=True)
 class EnumMember:
     name: str
     value: int
 
-@dataclass
+@dataclass(slots=True)
 class Enum:
     name: str
     members: list[EnumMember] = field(default_factory=list)
+    file: str | None = ...
+    ntype: str = ...
 
-@dataclass
+@dataclass(slots=True)
 class UnnamedObject:
     is_union: bool
     file: str
@@ -58,3 +77,10 @@ class UnnamedObject:
     def __hash__(self): ...
     def __eq__(self, other): ...
     def to_str(self, put_at_start: bool) -> str: ...
+
+
+@dataclass(slots=True)
+class HeaderGuard:
+    first_macro: str
+    pragma_once: bool
+    guard: str | None = ...
@@ -0,0 +1,104 @@
+"""
+Call profiling for --profile-bindings. Each linked function is bound under
+a private name and wrapped by a function with the public name that counts
+calls and sums their wall time in one generated table per output, so apps
+need no changes. `<prefix>_profile_dump(n)` prints the n calls that took the
+longest in total; call it before exiting. Setting `<PREFIX>_PROFILE` to false
+in the generated file turns every wrapper into a plain forwarding call, and
+regenerating without the flag removes them entirely.
+"""
+from typing import List
+
+from out_types import Function
+
+# Prefix of the raw #linkid declarations the wrappers call
+RAW_PREFIX = "_c_"
+
+
+def profiled(func: Function) -> bool:
+    """Whether func gets a wrapper: linked, and with fixed arguments to forward."""
+    return func.body is None and not func.is_variadic
+
+
+def wrapper(func: Function, slot: int, prefix: str, qualify=str) -> str:
+    """
+    The raw declaration of func plus the public wrapper recording into slot.
+    Locals are _prof_ prefixed so they cannot shadow a parameter.
+    """
+    params = ", ".join(f"{qualify(p.ntype)} {p.name}" for p in func.parameters)
+    args = ", ".join(p.name for p in func.parameters)
+    returns = func.return_type != "void"
+    return_type = f":{qualify(func.return_type)}" if returns else ""
+    call = f"{RAW_PREFIX}{func.name}({args})"
+    lines = [
+        f"#linkid {func.c_name}",
+        f"fn {RAW_PREFIX}{func.name}({params}){return_type}",
+        "",
+        f"fn {func.name}({params}){return_type} {{",
+        f"    if !{prefix.upper()}_PROFILE {{",
+        f"        return {call}" if returns else f"        {call}",
+    ]
+    if not returns:
+        lines.append("        return")
+    lines += ["    }", f"    i64 _prof_start = {prefix}_profile_now()"]
+    if returns:
+        lines += [f"    var _prof_result = {call}", f"    {prefix}_profile_record({slot}, _prof_start)",
+                  "    return _prof_result"]
+    else:
+        lines += [f"    {call}", f"    {prefix}_profile_record({slot}, _prof_start)"]
+    lines.append("}\n")
+    return "\n".join(lines)
+
+
+def table(prefix: str, names: List[str]) -> str:
+    """The counters, the clock and the dump function for the wrapped functions, in slot order."""
+    n = len(names)
+    zeros = ", ".join(["0"] * n)
+    quoted = ", ".join(f"'{name}'" for name in names)
+    flag = f"{prefix.upper()}_PROFILE"
+    return "\n".join([
+        "// Call profiling (--profile-bindings)",
+        f"const {flag} = true",
+        f"[string;{n}] {prefix}_profile_names = [{quoted}]",
+        f"[i64;{n}] {prefix}_profile_calls = [{zeros}]",
+        f"[i64;{n}] {prefix}_profile_nanos = [{zeros}]",
+        "",
+        f"type {prefix}_profile_timespec = struct {{",
+        "    i64 tv_sec",
+        "    i64 tv_nsec",
+        "}",
+        "",
+        "#linkid timespec_get",
+        f"fn {prefix}_profile_timespec_get(rawptr<{prefix}_profile_timespec> ts, i32 base):i32",
+        "",
+        f"fn {prefix}_profile_now():i64 {{",
+        f"    var ts = {prefix}_profile_timespec{{tv_sec = 0, tv_nsec = 0}}",
+        f"    {prefix}_profile_timespec_get(&ts, 1)  // TIME_UTC",
+        "    return ts.tv_sec * 1000000000 + ts.tv_nsec",
+        "}",
+        "",
+        f"fn {prefix}_profile_record(int slot, i64 start) {{",
+        f"    {prefix}_profile_calls[slot] += 1",
+        f"    {prefix}_profile_nanos[slot] += {prefix}_profile_now() - start",
+        "}",
+        "",
+        "// Prints the top functions by total time spent in them",
+        f"fn {prefix}_profile_dump(int top) {{",
+        f"    var left = {prefix}_profile_nanos",
+        "    println('FFI calls by total time:')",
+        "    for int rank = 0; rank < top; rank += 1 {",
+        "        int best = -1",
+        f"        for int i = 0; i < {n}; i += 1 {{",
+        f"            if {prefix}_profile_calls[i] > 0 && left[i] >= 0 && (best < 0 || left[i] > left[best]) {{",
+        "                best = i",
+        "            }",
+        "        }",
+        "        if best < 0 {",
+        "            break",
+        "        }",
+        f"        println('  ', {prefix}_profile_names[best], ': ', {prefix}_profile_calls[best], ' calls, ', "
+        f"left[best] / 1000, ' us')",
+        "        left[best] = -1",
+        "    }",
+        "}\n",
+    ])
@@ -0,0 +1,7 @@
+from out_types import Function
+
+RAW_PREFIX: str
+
+def profiled(func: Function) -> bool: ...
+def wrapper(func: Function, slot: int, prefix: str, qualify=...) -> str: ...
+def table(prefix: str, names: list[str]) -> str: ...
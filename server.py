@@ -0,0 +1,186 @@
+"""
+Warm binding server, started with `python3 main.py --serve`.
+
+Reads one JSON-RPC 2.0 request per line on stdin and writes one response per
+line on stdout; logs go to stderr as usual. libclang, the Index and every
+header's translation unit stay resident between requests, and a header is
+only reparsed (in place, with TranslationUnit.reparse) when it or a file it
+includes changed on disk.
+
+Methods:
+    generate {"header": str, "output": str?, "include_dirs": [str]?}
+        -> {"output": str, "bytes": int, "written": bool, "reparsed": bool,
+            "regenerated": bool, "seconds": float}
+        written is false when the output already held the same text (its
+        mtime is left alone).
+    forget {"header": str}   drops the resident translation unit(s) of header
+    stats {}                 -> {"headers": [str], "requests": int}
+    shutdown {}              answers null, then the server exits
+"""
+import argparse
+import dataclasses
+import inspect
+import json
+import os
+import sys
+import time
+from typing import Any, Dict, List, Optional, TextIO, Tuple
+
+from clang.cindex import Index, TranslationUnit
+
+from depfile import write_if_changed
+from filters import DeclFilter
+from instrument import log, timings
+from main import BindingGenerator
+from model import EmitOptions
+from tu_cache import TUCache
+
+# JSON-RPC 2.0 error codes
+PARSE_ERROR = -32700
+INVALID_REQUEST = -32600
+METHOD_NOT_FOUND = -32601
+INVALID_PARAMS = -32602
+SERVER_ERROR = -32000
+
+
+class RpcError(Exception):
+    def __init__(self, code: int, message: str):
+        super().__init__(message)
+        self.code = code
+
+
+@dataclasses.dataclass
+class _Resident:
+    """A parsed header kept in memory, with the file stamps it was parsed from."""
+    tu: TranslationUnit
+    stamps: Dict[str, Tuple[int, int]]
+    text: Optional[str] = None  # Generated bindings for the current tu
+
+
+def _stamp(path: str) -> Tuple[int, int]:
+    try:
+        st = os.stat(path)
+    except OSError:
+        return (-1, -1)
+    return (st.st_mtime_ns, st.st_size)
+
+
+def _stamps(tu: TranslationUnit, header_path: str) -> Dict[str, Tuple[int, int]]:
+    paths = {os.path.abspath(header_path)}
+    paths.update(os.path.abspath(inc.include.name) for inc in tu.get_includes())
+    return {path: _stamp(path) for path in paths}
+
+
+class BindingServer:
+    METHODS = ("generate", "forget", "stats", "shutdown")
+
+    def __init__(self, include_dirs: List[str], cache_dir: Optional[str] = None,
+                 decl_filter: Optional[DeclFilter] = None, emit: Optional[EmitOptions] = None):
+        self.index = Index.create()
+        self.include_dirs = include_dirs
+        self.decl_filter = decl_filter
+        self.emit = emit or EmitOptions()
+        # Only macro PCHs come from the disk cache: resident TUs are reparsed
+        # in place, which a TU loaded from a saved AST does not support
+        self.tu_cache = TUCache(cache_dir) if cache_dir else None
+        self.resident: Dict[Tuple[str, Tuple[str, ...]], _Resident] = {}
+        self.requests = 0
+        self.running = True
+
+    def generate(self, header: str, output: Optional[str] = None,
+                 include_dirs: Optional[List[str]] = None) -> Dict[str, Any]:
+        start = time.perf_counter()
+        timings.reset()
+        header = os.path.abspath(header)
+        output = output or os.path.splitext(header)[0] + ".n"
+        clang_args = [f"-I{d}" for d in self.include_dirs + (include_dirs or [])]
+        key = (header, tuple(clang_args))
+
+        entry = self.resident.get(key)
+        reparsed = False
+        if entry is None:
+            tu = BindingGenerator().parse_translation_unit(header, clang_args, self.index)
+            entry = self.resident[key] = _Resident(tu=tu, stamps=_stamps(tu, header))
+        elif any(_stamp(path) != stamp for path, stamp in entry.stamps.items()):
+            log.info("Reparsing changed header: %s", header)
+            with timings.phase("clang reparse"):
+                entry.tu.reparse()
+            entry.stamps = _stamps(entry.tu, header)
+            entry.text = None
+            reparsed = True
+
+        regenerated = entry.text is None
+        if regenerated:
+            generator = BindingGenerator(tu_cache=self.tu_cache, decl_filter=self.decl_filter)
+            generator.collect(entry.tu, header, clang_args)
+            with timings.phase("emission"):
+                entry.text = generator.generate_bindings(options=self.emit)
+
+        written = write_if_changed(output, entry.text)
+        return {
+            "output": output,
+            "bytes": len(entry.text),
+            "written": written,
+            "reparsed": reparsed,
+            "regenerated": regenerated,
+            "seconds": time.perf_counter() - start,
+        }
+
+    def forget(self, header: str) -> None:
+        header = os.path.abspath(header)
+        for key in [k for k in self.resident if k[0] == header]:
+            del self.resident[key]
+
+    def stats(self) -> Dict[str, Any]:
+        return {"headers": sorted({k[0] for k in self.resident}), "requests": self.requests}
+
+    def shutdown(self) -> None:
+        self.running = False
+
+    def handle(self, line: str) -> Optional[Dict[str, Any]]:
+        """Answer one request line; notifications (no id) get no response."""
+        request_id = None
+        try:
+            try:
+                request = json.loads(line)
+            except ValueError as e:
+                raise RpcError(PARSE_ERROR, f"invalid JSON: {e}")
+            if not isinstance(request, dict) or not isinstance(request.get("method"), str):
+                raise RpcError(INVALID_REQUEST, "expected an object with a method")
+            request_id = request.get("id")
+            method = getattr(self, request["method"], None) if request["method"] in self.METHODS else None
+            if method is None:
+                raise RpcError(METHOD_NOT_FOUND, f"unknown method: {request['method']}")
+            params = request.get("params") or {}
+            if not isinstance(params, dict):
+                raise RpcError(INVALID_PARAMS, "params must be an object")
+            try:
+                inspect.signature(method).bind(**params)
+            except TypeError as e:
+                raise RpcError(INVALID_PARAMS, str(e))
+            self.requests += 1
+            try:
+                result = method(**params)
+            except Exception as e:
+                log.error("%s failed: %s", request["method"], e)
+                raise RpcError(SERVER_ERROR, str(e))
+            response = {"jsonrpc": "2.0", "id": request_id, "result": result}
+        except RpcError as e:
+            response = {"jsonrpc": "2.0", "id": request_id, "error": {"code": e.code, "message": str(e)}}
+        return response if request_id is not None or "error" in response else None
+
+
+def serve(options: argparse.Namespace, stdin: TextIO = sys.stdin, stdout: TextIO = sys.stdout):
+    """Run a BindingServer over stdin/stdout until shutdown or end of input."""
+    server = BindingServer(options.include_dirs, options.cache_dir, DeclFilter.from_rules(vars(options)),
+                           EmitOptions.from_args(options))
+    log.info("naturebindgen server ready")
+    for line in stdin:
+        if not line.strip():
+            continue
+        response = server.handle(line)
+        if response is not None:
+            stdout.write(json.dumps(response) + "\n")
+            stdout.flush()
+        if not server.running:
+            break
@@ -0,0 +1,34 @@
+import argparse
+from clang.cindex import Index, TranslationUnit
+from filters import DeclFilter
+from model import EmitOptions
+from tu_cache import TUCache
+from typing import Any, TextIO
+
+PARSE_ERROR: int
+INVALID_REQUEST: int
+METHOD_NOT_FOUND: int
+INVALID_PARAMS: int
+SERVER_ERROR: int
+
+class RpcError(Exception):
+    code: int
+    def __init__(self, code: int, message: str) -> None: ...
+
+class BindingServer:
+    METHODS: tuple[str, ...]
+    index: Index
+    include_dirs: list[str]
+    decl_filter: DeclFilter | None
+    emit: EmitOptions
+    tu_cache: TUCache | None
+    requests: int
+    running: bool
+    def __init__(self, include_dirs: list[str], cache_dir: str | None = None, decl_filter: DeclFilter | None = None, emit: EmitOptions | None = None) -> None: ...
+    def generate(self, header: str, output: str | None = None, include_dirs: list[str] | None = None) -> dict[str, Any]: ...
+    def forget(self, header: str) -> None: ...
+    def stats(self) -> dict[str, Any]: ...
+    def shutdown(self) -> None: ...
+    def handle(self, line: str) -> dict[str, Any] | None: ...
+
+def serve(options: argparse.Namespace, stdin: TextIO = ..., stdout: TextIO = ...) -> None: ...
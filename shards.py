@@ -0,0 +1,150 @@
+"""
+Sharded parsing of umbrella headers (--umbrella-jobs). An umbrella header
+such as SDL3/SDL.h only includes other headers, so instead of one TU walking
+all of them, each direct include is parsed and walked on its own in a
+worker process and the shard models are merged in include order. Headers
+several shards pull in are walked by each of them; the merge keeps the
+first copy of a declaration and reports names two shards define
+differently. Anonymous records are named by context or source location,
+never by anything TU-specific, so all shards agree on their names.
+"""
+import dataclasses
+import os
+import re
+from typing import TYPE_CHECKING, Any, Dict, List, Optional
+
+from model import BindingModel
+
+if TYPE_CHECKING:
+    from main import BindingGenerator
+
+_COMMENT_RE = re.compile(r"/\*.*?\*/|//[^\n]*", re.S)
+_INCLUDE_RE = re.compile(r'#\s*include\s*([<"])([^>"]+)[>"]\s*$')
+_GUARD_RE = re.compile(r"#\s*(ifndef|define)\s+(\w+)\s*$")
+
+
+@dataclasses.dataclass
+class Shard:
+    """One direct include of an umbrella header, parsed as a TU of its own."""
+    header: str
+    # Includes of the umbrella before this one that are no shard (system headers),
+    # passed with -include so a sub-header relying on them still compiles alone
+    preinclude: List[str] = dataclasses.field(default_factory=list)
+
+    def clang_args(self, clang_args: List[str]) -> List[str]:
+        return clang_args + [arg for name in self.preinclude for arg in ("-include", name)]
+
+
+def _resolve(name: str, quoted: bool, base: str, include_dirs: List[str]) -> Optional[str]:
+    for directory in ([base] if quoted else []) + include_dirs:
+        path = os.path.join(directory, name)
+        if os.path.isfile(path):
+            return os.path.realpath(path)
+    return None
+
+
+def umbrella_shards(header_path: str, clang_args: List[str]) -> Optional[List[Shard]]:
+    """
+    The shards of header_path: its direct includes found beside it or
+    under a -I directory, in include order. None unless the header is
+    only an include guard and #include lines, with at least two of them,
+    as anything else could change how the sub-headers compile.
+    """
+    with open(header_path, encoding="utf-8", errors="replace") as f:
+        lines = [line.strip() for line in _COMMENT_RE.sub("", f.read()).splitlines()]
+    lines = [line for line in lines if line and not re.fullmatch(r"#\s*pragma\s+once", line)]
+    guards = [_GUARD_RE.match(line) for line in lines[:2]]
+    if (len(lines) > 2 and all(guards) and guards[0][1] == "ifndef" and guards[1][1] == "define"
+            and guards[0][2] == guards[1][2] and re.fullmatch(r"#\s*endif", lines[-1])):
+        lines = lines[2:-1]
+    include_dirs = [arg[2:] for arg in clang_args if arg.startswith("-I") and len(arg) > 2]
+    base = os.path.dirname(os.path.abspath(header_path))
+    shards: List[Shard] = []
+    preinclude: List[str] = []
+    for line in lines:
+        match = _INCLUDE_RE.fullmatch(line)
+        if match is None:
+            return None
+        path = _resolve(match[2], match[1] == '"', base, include_dirs)
+        if path is None:
+            preinclude.append(match[2])
+        elif all(s.header != path for s in shards):
+            shards.append(Shard(path, list(preinclude)))
+    return shards if len(shards) >= 2 else None
+
+
+def _same(a: Any, b: Any) -> bool:
+    """Whether two model entries agree, wherever each was declared."""
+    if dataclasses.is_dataclass(a) and dataclasses.is_dataclass(b):
+        a, b = dataclasses.asdict(a), dataclasses.asdict(b)
+        a.pop("file", None)
+        b.pop("file", None)
+    return a == b
+
+
+class ShardMerger:
+    """
+    Folds shard models into one, in shard order. A (kind, name) seen again
+    that matches the kept entry (wherever it was declared) is dropped. One
+    that differs is a conflict listed in conflicts: it "differs between
+    shards" under the USR the name was first recorded with, and "is defined
+    twice" under another. The first entry is kept either way.
+    """
+
+    def __init__(self, model: "BindingGenerator"):
+        self.model = model  # Merged into in place, with its translated and untranslated lists
+        self.conflicts: List[str] = []
+        self._usrs: Dict[tuple[str, str], str] = {}
+        self._origin: Dict[tuple[str, str], str] = {}  # (kind, name) -> shard header it came from
+
+    def _add(self, kind: str, table: Dict[str, Any], name: str, value: Any, usr: Optional[str], shard: str) -> bool:
+        key = (kind, name)
+        if name not in table:
+            table[name] = value
+            self._origin[key] = shard
+            if usr:
+                self._usrs[key] = usr
+            return True
+        kept = table[name]
+        if _same(kept, value):
+            return False
+        known = self._usrs.get(key)
+        where = lambda v, s: getattr(v, "file", None) or s
+        reason = "differs between shards" if usr and usr == known else "is defined twice"
+        self.conflicts.append(f"{kind} {name} {reason}: {where(kept, self._origin[key])} "
+                              f"(kept) and {where(value, shard)}")
+        return False
+
+    def merge(self, shard: str, data: Dict[str, Any], usrs: Dict[tuple[str, str], str]):
+        """Add one shard's model (BindingModel.to_dict) and the USRs of its declarations."""
+        part = BindingModel.from_dict(data)
+        model = self.model
+        for name, struct in part.structs.items():
+            self._add("struct", model.structs, name, struct, usrs.get(("struct", name)), shard)
+        for name, union in part.unions.items():
+            if self._add("union", model.unions, name, union, usrs.get(("union", name)), shard):
+                model.union_sizes[name] = part.union_sizes.get(name, union.size)
+        for name, enum in part.enums.items():
+            self._add("enum", model.enums, name, enum, usrs.get(("enum", name)), shard)
+        for name, func in part.functions.items():
+            self._add("function", model.functions, name, func,
+                      usrs.get(("fn", name)) or usrs.get(("macro", name)), shard)
+        for name, const in part.constants.items():
+            self._add("constant", model.constants, name, const, usrs.get(("macro", name)), shard)
+        for name, mapped in part.typedefs.items():
+            self._add("typedef", model.typedefs, name, mapped, usrs.get(("typedef", name)), shard)
+        for key, name in part.clang_to_contextual.items():
+            model.clang_to_contextual.setdefault(key, name)
+
+    def merge_translations(self, translated: List[str], untranslated: Dict[str, str]):
+        model = self.model
+        known = set(model.translated)
+        model.translated.extend(name for name in translated if name not in known)
+        for name, reason in untranslated.items():
+            model.untranslated.setdefault(name, reason)
+
+    def finish(self):
+        """Drop untranslated entries another shard translated after all."""
+        model = self.model
+        for name in set(model.translated) & model.untranslated.keys():
+            del model.untranslated[name]
@@ -0,0 +1,18 @@
+from main import BindingGenerator
+from typing import Any
+
+class Shard:
+    header: str
+    preinclude: list[str] = ...
+    def __init__(self, header: str, preinclude: list[str] = ...) -> None: ...
+    def clang_args(self, clang_args: list[str]) -> list[str]: ...
+
+def umbrella_shards(header_path: str, clang_args: list[str]) -> list[Shard] | None: ...
+
+class ShardMerger:
+    model: BindingGenerator
+    conflicts: list[str]
+    def __init__(self, model: BindingGenerator) -> None: ...
+    def merge(self, shard: str, data: dict[str, Any], usrs: dict[tuple[str, str], str]): ...
+    def merge_translations(self, translated: list[str], untranslated: dict[str, str]): ...
+    def finish(self) -> None: ...
@@ -0,0 +1,195 @@
+import dataclasses
+import os
+import re
+from typing import Dict, List, Optional, Set
+
+from out_types import Constant, Enum, Function, Struct, Union
+from usage import type_names
+
+_IDENT_RE = re.compile(r"[A-Za-z_]\w*")
+_LITERAL_TYPE_RE = re.compile(r"\b([A-Za-z_]\w*)(?=\s*\{)")  # Color in Color{...}
+
+
+@dataclasses.dataclass
+class Module:
+    """The declarations of one output file in --split mode."""
+    name: str
+    path: str
+    constants: List[Constant] = dataclasses.field(default_factory=list)
+    enums: List[Enum] = dataclasses.field(default_factory=list)
+    unions: List[Union] = dataclasses.field(default_factory=list)
+    structs: List[Struct] = dataclasses.field(default_factory=list)
+    functions: List[Function] = dataclasses.field(default_factory=list)
+    imports: List["Module"] = dataclasses.field(default_factory=list)
+    # Type name, or symbol a translated body names, -> module defining it
+    foreign: Dict[str, str] = dataclasses.field(default_factory=dict)
+
+    def qualify(self, ntype: str) -> str:
+        """ntype (or a translated body line) with names from imported modules written as module.Name."""
+        if not self.foreign:
+            return ntype
+        return _IDENT_RE.sub(lambda m: f"{self.foreign[m[0]]}.{m[0]}" if m[0] in self.foreign else m[0], ntype)
+
+    def qualify_value(self, value: str) -> str:
+        if not self.foreign:
+            return value
+        return _LITERAL_TYPE_RE.sub(lambda m: self.qualify(m[0]), value)
+
+    def import_lines(self) -> List[str]:
+        return [f"import '{os.path.basename(m.path)}' as {m.name}" for m in self.imports]
+
+
+def _identifier(stem: str) -> str:
+    name = re.sub(r"\W", "_", stem)
+    return f"_{name}" if name[:1].isdigit() else name
+
+
+def plan_modules(generator, header_path: str, main_path: str) -> List[Module]:
+    """
+    Split a generator's model by the header each declaration came from. The
+    bound header goes to main_path; every other header to <stem>.n beside
+    it. Records used outside their own header's module (and everything such
+    a record reaches) move to a shared <main>_types module, as do all unions,
+    which are shared by size anyway, and the records their members use, so
+    header modules only ever import the shared one and imports cannot form
+    cycles. For the same reason a translated body (macro or static inline)
+    that names a function, constant or enum member of another header moves
+    to the shared module, with everything it names in turn.
+    """
+    out_dir = os.path.dirname(main_path)
+    main_name = _identifier(os.path.splitext(os.path.basename(main_path))[0])
+    header = os.path.abspath(header_path)
+    modules: Dict[str, Module] = {}
+    by_file: Dict[Optional[str], Module] = {}
+    main = modules[main_name] = by_file[header] = Module(main_name, main_path)
+    by_file[None] = main
+
+    def module_of(file_name: Optional[str]) -> Module:
+        key = os.path.abspath(file_name) if file_name else None
+        module = by_file.get(key)
+        if module is None:
+            name = base = _identifier(os.path.splitext(os.path.basename(key))[0])
+            n = 2
+            while name in modules or name == f"{main_name}_types":
+                name, n = f"{base}_{n}", n + 1
+            module = modules[name] = by_file[key] = Module(name, os.path.join(out_dir, f"{name}.n"))
+        return module
+
+    home: Dict[str, Module] = {}  # Struct name -> module it is emitted in
+    for struct in generator.structs.values():
+        home[struct.name] = module_of(struct.file)
+    shared = Module(f"{main_name}_types", os.path.join(out_dir, f"{main_name}_types.n"))
+    union_names = {u.name for u in generator.unions.values()}
+
+    # Symbols translated bodies can name: function, constant or enum member -> (kind, name)
+    # of the declaration emitting it, and the module each declaration goes to
+    owner: Dict[str, tuple[str, str]] = {}
+    placed: Dict[tuple[str, str], Module] = {}
+    for func in generator.functions.values():
+        owner[func.name] = ("fn", func.name)
+        placed[("fn", func.name)] = module_of(func.file)
+    for const in generator.constants.values():
+        owner[const.name] = ("const", const.name)
+        placed[("const", const.name)] = module_of(const.file)
+    for enum in generator.enums.values():
+        for member in enum.members:
+            owner[f"{enum.name}_{member.name}"] = ("enum", enum.name)
+        placed[("enum", enum.name)] = module_of(enum.file)
+
+    def named_by(key: tuple[str, str]) -> Set[tuple[str, str]]:
+        func = generator.functions[key[1]] if key[0] == "fn" else None
+        if func is None or not func.body:
+            return set()
+        return {owner[n] for line in func.body for n in _IDENT_RE.findall(line) if n in owner} - {key}
+
+    for func in generator.functions.values():
+        key = ("fn", func.name)
+        if any(placed[k] is not placed[key] and placed[k] is not shared for k in named_by(key)):
+            stack = [key]
+            while stack:
+                key = stack.pop()
+                if placed[key] is not shared:
+                    placed[key] = shared
+                    stack.extend(named_by(key))
+    shared_symbols = {name for name, key in owner.items() if placed[key] is shared}
+
+    # Which modules name each struct, starting from everything but the structs themselves
+    users: Dict[str, Set[str]] = {}
+
+    def uses(module: Module, ntype: str):
+        for name in type_names(ntype):
+            if name in home:
+                users.setdefault(name, set()).add(module.name)
+
+    for func in generator.functions.values():
+        module = placed[("fn", func.name)]
+        module.functions.append(func)
+        uses(module, func.return_type)
+        for param in func.parameters:
+            uses(module, param.ntype)
+        for line in func.body or ():
+            uses(module, line)
+    for const in sorted(generator.constants.values(), key=lambda c: c.name):
+        module = placed[("const", const.name)]
+        module.constants.append(const)
+        uses(module, const.ctype)
+        for name in _LITERAL_TYPE_RE.findall(const.value):
+            uses(module, name)
+    for enum in generator.enums.values():
+        placed[("enum", enum.name)].enums.append(enum)
+
+    def share(name: str):
+        """Move a struct to the shared module, with every struct its fields reach."""
+        stack = [name]
+        while stack:
+            name = stack.pop()
+            if home[name] is not shared:
+                home[name] = shared
+                stack.extend(n for f in generator.structs[name].fields for n in type_names(f.ntype) if n in home)
+
+    for name, module in list(home.items()):
+        if users.get(name, set()) - {module.name}:
+            share(name)
+    # Union accessors live in the shared module and name their members' types
+    for union in generator.unions.values():
+        for n in (n for f in union.fields for n in type_names(f.ntype) if n in home):
+            share(n)
+    # A struct staying home can still use a struct homed in another header
+    changed = True
+    while changed:
+        changed = False
+        for struct in generator.structs.values():
+            module = home[struct.name]
+            if module is shared:
+                continue
+            for n in (n for f in struct.fields for n in type_names(f.ntype) if n in home):
+                if home[n] is not module and home[n] is not shared:
+                    share(n)
+                    changed = True
+
+    for struct in generator.structs.values():
+        home[struct.name].structs.append(struct)
+    # Every union, so the emitter groups same-size ones into one type with all their accessors
+    shared.unions.extend(generator.unions.values())
+
+    shared_names = {s.name for s in shared.structs} | union_names | shared_symbols
+    result = list(modules.values())
+    if shared.structs or shared.unions or shared.functions or shared.constants or shared.enums:
+        result.append(shared)
+    for module in result:
+        if module is shared:
+            continue
+        module.foreign = {name: shared.name for name in shared_names}
+        if _references(module, shared_names):
+            module.imports.append(shared)
+    return [m for m in result if m is main or m.constants or m.enums or m.unions or m.structs or m.functions]
+
+
+def _references(module: Module, names: Set[str]) -> bool:
+    types = [f.return_type for f in module.functions]
+    types += [p.ntype for f in module.functions for p in f.parameters]
+    types += [line for f in module.functions for line in f.body or ()]
+    types += [f.ntype for s in module.structs for f in s.fields]
+    types += [c.ctype for c in module.constants]
+    types += [n for c in module.constants for n in _LITERAL_TYPE_RE.findall(c.value)]
+    return any(n in names for t in types for n in type_names(t))
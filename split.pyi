@@ -0,0 +1,18 @@
+from out_types import Constant, Enum, Function, Struct, Union
+
+class Module:
+    name: str
+    path: str
+    constants: list[Constant]
+    enums: list[Enum]
+    unions: list[Union]
+    structs: list[Struct]
+    functions: list[Function]
+    imports: list[Module]
+    foreign: dict[str, str]
+    def qualify(self, ntype: str) -> str: ...
+    def qualify_value(self, value: str) -> str: ...
+    def import_lines(self) -> list[str]: ...
+    def __init__(self, name: str, path: str, constants: list[Constant] = ..., enums: list[Enum] = ..., unions: list[Union] = ..., structs: list[Struct] = ..., functions: list[Function] = ..., imports: list[Module] = ..., foreign: dict[str, str] = ...) -> None: ...
+
+def plan_modules(generator, header_path: str, main_path: str) -> list[Module]: ...
@@ -1,3 +1,3 @@
-stubgen main.py macro_processor.py out_types.py expr_ast.py
+stubgen main.py macro_processor.py out_types.py expr_ast.py tu_cache.py decl_cache.py instrument.py server.py depfile.py filters.py usage.py split.py layout.py translate.py symbols.py profiling.py shards.py model.py
 mv out/*.pyi ./
 rm -rf out
\ No newline at end of file
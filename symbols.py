@@ -0,0 +1,363 @@
+"""
+The symbols libraries export, read without external tools: ar archives
+(through their GNU or BSD symbol index, or their member objects when they
+have none), ELF and Mach-O objects and shared libraries, and universal
+Mach-O files holding one of those per architecture. Each library yields
+the exported symbols per platform (linux_amd64, darwin_arm64, ...), which
+is also what package.toml's [links] table is keyed by. Indexes are cached
+by the library's content hash, so a large archive is only read once per
+version.
+"""
+import dataclasses
+import json
+import os
+import re
+import struct
+from typing import Dict, Iterator, List, Optional, Set, Tuple
+
+from depfile import hash_file, write_if_changed
+from instrument import log, timings
+
+# Bump when the cached index layout or what counts as exported changes
+SYMBOLS_VERSION = 1
+
+_AR_MAGIC = b"!<arch>\n"
+_ELF_MAGIC = b"\x7fELF"
+_FAT_MAGICS = {b"\xca\xfe\xba\xbe": False, b"\xca\xfe\xba\xbf": True}  # Big-endian; value: 64-bit offsets
+_MACHO_MAGICS = {b"\xcf\xfa\xed\xfe": ("<", True), b"\xfe\xed\xfa\xcf": (">", True),
+                 b"\xce\xfa\xed\xfe": ("<", False), b"\xfe\xed\xfa\xce": (">", False)}
+
+_ELF_MACHINES = {3: "386", 40: "arm", 62: "amd64", 183: "arm64", 243: "riscv64"}
+_ELF_OSABI = {9: "freebsd", 12: "openbsd"}  # Anything else is taken as Linux
+_MACHO_CPUS = {7: "386", 0x01000007: "amd64", 12: "arm", 0x0100000c: "arm64"}
+
+_PLATFORM_SUFFIX_RE = re.compile(r"[_-](?:linux|darwin|macos|freebsd|openbsd|windows)[_-]\w+$")
+_LIBRARY_EXT_RE = re.compile(r"\.(?:a|lib|so(?:\.\d+)*|dylib)$")
+
+
+@dataclasses.dataclass
+class Library:
+    """A library the bindings link against, as given to --link."""
+    name: str  # Key in package.toml's [links]
+    path: str
+    symbols: Dict[str, Set[str]] = dataclasses.field(default_factory=dict)  # Platform -> exported symbols
+
+    @classmethod
+    def from_spec(cls, spec: str) -> "Library":
+        """`NAME=PATH`, or just PATH with the name taken from the file (libraylib_linux_amd64.a -> raylib)."""
+        name, sep, path = spec.partition("=")
+        if not sep:
+            path = spec
+            name = _LIBRARY_EXT_RE.sub("", os.path.basename(path))
+            name = _PLATFORM_SUFFIX_RE.sub("", name.removeprefix("lib")) or name
+        return cls(name=name, path=path)
+
+
+# --- Object files ---
+
+def _cstr(table: bytes, offset: int) -> str:
+    end = table.find(b"\0", offset)
+    return table[offset:end if end >= 0 else len(table)].decode("utf-8", "replace")
+
+
+def _elf_platform(data: bytes) -> Optional[str]:
+    if len(data) < 20 or data[:4] != _ELF_MAGIC:
+        return None
+    order = "<" if data[5] == 1 else ">"
+    machine = struct.unpack_from(f"{order}H", data, 18)[0]
+    arch = _ELF_MACHINES.get(machine)
+    return f"{_ELF_OSABI.get(data[7], 'linux')}_{arch}" if arch else None
+
+
+def _elf_symbols(data: bytes) -> Set[str]:
+    """Defined global and weak symbols: .dynsym of a shared object, .symtab of a relocatable one."""
+    is64, order = data[4] == 2, "<" if data[5] == 1 else ">"
+    e_type = struct.unpack_from(f"{order}H", data, 16)[0]
+    if is64:
+        shoff, = struct.unpack_from(f"{order}Q", data, 0x28)
+        shentsize, shnum = struct.unpack_from(f"{order}HH", data, 0x3a)
+    else:
+        shoff, = struct.unpack_from(f"{order}I", data, 0x20)
+        shentsize, shnum = struct.unpack_from(f"{order}HH", data, 0x2e)
+    sections = []
+    for i in range(shnum):
+        at = shoff + i * shentsize
+        if is64:
+            _, sh_type, _, _, offset, size, link, _, _, entsize = struct.unpack_from(f"{order}IIQQQQIIQQ", data, at)
+        else:
+            _, sh_type, _, _, offset, size, link, _, _, entsize = struct.unpack_from(f"{order}IIIIIIIIII", data, at)
+        sections.append((sh_type, offset, size, link, entsize))
+    wanted = 11 if e_type == 3 else 2  # SHT_DYNSYM for ET_DYN, else SHT_SYMTAB
+    symbols: Set[str] = set()
+    for sh_type, offset, size, link, entsize in sections:
+        if sh_type != wanted or not entsize:
+            continue
+        _, str_offset, str_size, _, _ = sections[link]
+        strtab = bytes(data[str_offset:str_offset + str_size])
+        for at in range(offset + entsize, offset + size, entsize):  # Entry 0 is the null symbol
+            if is64:
+                name, info, other, shndx = struct.unpack_from(f"{order}IBBH", data, at)
+            else:
+                name, = struct.unpack_from(f"{order}I", data, at)
+                info, other, shndx = struct.unpack_from(f"{order}BBH", data, at + 12)
+            bind, kind, visibility = info >> 4, info & 0xf, other & 3
+            # Global, weak or unique; defined; a function, object or untyped; visible outside
+            if bind in (1, 2, 10) and shndx != 0 and kind in (0, 1, 2, 10) and visibility in (0, 3) and name:
+                symbols.add(_cstr(strtab, name))
+    return symbols
+
+
+def _macho_header(data: bytes) -> Optional[Tuple[str, bool, int]]:
+    """(byte order, 64-bit, cputype) of a thin Mach-O object."""
+    magic = _MACHO_MAGICS.get(bytes(data[:4]))
+    if magic is None or len(data) < 28:
+        return None
+    order, is64 = magic
+    return order, is64, struct.unpack_from(f"{order}i", data, 4)[0] & 0xffffffff
+
+
+def _macho_platform(cputype: int) -> Optional[str]:
+    arch = _MACHO_CPUS.get(cputype)
+    return f"darwin_{arch}" if arch else None
+
+
+def _macho_symbols(data: bytes) -> Set[str]:
+    """External symbols defined in a section, without the leading underscore C names get."""
+    order, is64, _ = _macho_header(data)
+    ncmds, = struct.unpack_from(f"{order}I", data, 16)
+    at = 32 if is64 else 28
+    symbols: Set[str] = set()
+    for _ in range(ncmds):
+        cmd, cmdsize = struct.unpack_from(f"{order}II", data, at)
+        if cmd == 0x2:  # LC_SYMTAB
+            symoff, nsyms, stroff, strsize = struct.unpack_from(f"{order}IIII", data, at + 8)
+            strtab = bytes(data[stroff:stroff + strsize])
+            entry = 16 if is64 else 12
+            for i in range(nsyms):
+                strx, n_type = struct.unpack_from(f"{order}IB", data, symoff + i * entry)
+                # Not a debug entry, external, not private extern, defined in a section or absolute
+                if not n_type & 0xe0 and n_type & 0x01 and not n_type & 0x10 and n_type & 0x0e in (0x0e, 0x02):
+                    symbols.add(_cstr(strtab, strx).removeprefix("_"))
+        at += cmdsize
+    return symbols
+
+
+def _object(data: bytes) -> Optional[Tuple[str, Set[str]]]:
+    """(platform, exported symbols) of an ELF or Mach-O object, or None for anything else."""
+    platform = _elf_platform(data)
+    if platform is not None:
+        return platform, _elf_symbols(data)
+    header = _macho_header(data)
+    if header is not None and _macho_platform(header[2]):
+        return _macho_platform(header[2]), _macho_symbols(data)
+    return None
+
+
+# --- Archives ---
+
+def _ar_members(data: bytes) -> Iterator[Tuple[str, bytes]]:
+    """(name, contents) of every member, with GNU long names and BSD #1/ names resolved."""
+    pos, long_names = len(_AR_MAGIC), b""
+    while pos + 60 <= len(data):
+        header = bytes(data[pos:pos + 60])
+        name = header[:16].decode("ascii", "replace").rstrip()
+        size = int(header[48:58].decode("ascii").strip() or 0)
+        body = data[pos + 60:pos + 60 + size]
+        pos += 60 + size + (size & 1)
+        if name.startswith("#1/"):
+            n = int(name[3:])
+            name, body = bytes(body[:n]).rstrip(b"\0").decode("utf-8", "replace"), body[n:]
+        elif name == "//":
+            long_names = bytes(body)
+            continue
+        elif name.startswith("/") and name[1:].isdigit():
+            start = int(name[1:])
+            end = long_names.find(b"/\n", start)
+            name = long_names[start:end if end >= 0 else len(long_names)].decode("utf-8", "replace")
+        elif name.endswith("/") and name not in ("/", "/SYM64/"):
+            name = name[:-1]
+        yield name, body
+
+
+def _ar_index(name: str, body: bytes) -> Optional[List[str]]:
+    """The names in an archive's symbol index member, or None if name is not one."""
+    if name in ("/", "/SYM64/"):
+        width = 8 if name == "/SYM64/" else 4
+        count = int.from_bytes(body[:width], "big")
+        names = bytes(body[width * (count + 1):]).split(b"\0")[:count]
+        return [n.decode("utf-8", "replace") for n in names]
+    if name.startswith("__.SYMDEF"):
+        width = 8 if name.startswith("__.SYMDEF_64") else 4
+        ranlib_size = int.from_bytes(body[:width], "little")
+        strtab_at = width + ranlib_size
+        strtab_size = int.from_bytes(body[strtab_at:strtab_at + width], "little")
+        strtab = bytes(body[strtab_at + width:strtab_at + width + strtab_size])
+        offsets = range(width, width + ranlib_size, 2 * width)
+        # Mach-O archives are the ones with BSD indexes; their C names carry a leading underscore
+        return [_cstr(strtab, int.from_bytes(body[at:at + width], "little")).removeprefix("_") for at in offsets]
+    return None
+
+
+def _archive(data: bytes) -> Dict[str, Set[str]]:
+    index: Optional[List[str]] = None
+    by_platform: Dict[str, Set[str]] = {}
+    platform = None
+    for name, body in _ar_members(data):
+        names = _ar_index(name, body)
+        if names is not None:
+            index = names
+            continue
+        if index is not None:
+            # The index already lists every export; one object is enough to tell the platform
+            platform = platform or _elf_platform(body) or (_macho_header(body) and _macho_platform(_macho_header(body)[2]))
+            if platform:
+                break
+            continue
+        found = _object(body)
+        if found is not None:
+            by_platform.setdefault(found[0], set()).update(found[1])
+    if index is not None:
+        return {platform: set(index)} if platform else {}
+    return by_platform
+
+
+def read_library(path: str) -> Dict[str, Set[str]]:
+    """Platform -> exported symbols of the library at path; raises ValueError for unknown formats."""
+    with open(path, "rb") as f:
+        data = memoryview(f.read())
+    return _read(data, path)
+
+
+def _read(data, path: str) -> Dict[str, Set[str]]:
+    magic = bytes(data[:8])
+    if magic == _AR_MAGIC:
+        return _archive(data)
+    if magic[:4] in _FAT_MAGICS:
+        # Universal file: one thin library per architecture
+        wide = _FAT_MAGICS[magic[:4]]
+        count = struct.unpack_from(">I", data, 4)[0]
+        result: Dict[str, Set[str]] = {}
+        for i in range(count):
+            if wide:
+                _, _, offset, size = struct.unpack_from(">iiQQ", data, 8 + i * 32)
+            else:
+                _, _, offset, size = struct.unpack_from(">iiII", data, 8 + i * 20)
+            for platform, symbols in _read(data[offset:offset + size], path).items():
+                result.setdefault(platform, set()).update(symbols)
+        return result
+    found = _object(data)
+    if found is None:
+        raise ValueError(f"{path}: not an ar archive, ELF or Mach-O file")
+    return {found[0]: found[1]}
+
+
+class SymbolIndex:
+    """Reads libraries through an on-disk cache of their symbol tables, keyed by content hash."""
+
+    def __init__(self, cache_dir: Optional[str] = None):
+        self.cache_dir = os.path.join(cache_dir, "symbols") if cache_dir else None
+
+    def load(self, library: Library):
+        """Fill library.symbols, from the cache when the file is unchanged."""
+        digest = hash_file(library.path)
+        if digest is None:
+            raise FileNotFoundError(f"library not found: {library.path}")
+        cache_path = os.path.join(self.cache_dir, f"{digest[:32]}.json") if self.cache_dir else None
+        if cache_path is not None:
+            try:
+                with open(cache_path) as f:
+                    data = json.load(f)
+                if data.get("version") == SYMBOLS_VERSION:
+                    library.symbols = {p: set(names) for p, names in data["platforms"].items()}
+                    timings.count("symbol index hits")
+                    return
+            except (OSError, ValueError, KeyError):
+                pass
+        with timings.phase("symbols"):
+            library.symbols = read_library(library.path)
+        timings.count("symbol index misses")
+        if not library.symbols:
+            log.warning("No exported symbols found in %s", library.path)
+        if cache_path is not None:
+            os.makedirs(self.cache_dir, exist_ok=True)
+            write_if_changed(cache_path, json.dumps({"version": SYMBOLS_VERSION, "platforms": {
+                p: sorted(names) for p, names in sorted(library.symbols.items())}}, separators=(",", ":")))
+
+
+def _exported(c_name: str, symbols: Set[str]) -> bool:
+    # Models collected on macOS keep the underscore of the mangled name
+    return c_name in symbols or (c_name.startswith("_") and c_name[1:] in symbols)
+
+
+def verify_exports(model, libraries: List[Library], keep: bool = False) -> List[str]:
+    """
+    Check every linked function of model against the libraries. Functions
+    no library exports on any platform are removed (unless keep) and
+    logged as warnings; ones missing on only some platforms are logged at
+    info level. Returns report lines for the run summary.
+    """
+    platforms: Dict[str, Set[str]] = {}
+    for library in libraries:
+        for platform, symbols in library.symbols.items():
+            platforms.setdefault(platform, set()).update(symbols)
+    if not platforms:
+        return []
+    missing: List[str] = []
+    partial = 0
+    for name, func in list(model.functions.items()):
+        if func.body is not None:
+            continue  # Translated to Nature; nothing to link
+        absent = sorted(p for p, symbols in platforms.items() if not _exported(func.c_name, symbols))
+        if len(absent) == len(platforms):
+            missing.append(name)
+            log.warning("%s is not exported by %s", func.c_name, ", ".join(lib.path for lib in libraries))
+            if not keep:
+                del model.functions[name]
+        elif absent:
+            partial += 1
+            log.info("%s is not exported on %s", func.c_name, ", ".join(absent))
+    action = "kept" if keep else "dropped"
+    return [f"Symbols checked on {', '.join(sorted(platforms))}: {len(missing)} unexported functions {action}, "
+            f"{partial} missing on some platforms (listed with --log-level info)"]
+
+
+def _toml_string(text: str) -> str:
+    return f"'{text}'" if "'" not in text and "\n" not in text else json.dumps(text)
+
+
+def links_table(libraries: List[Library], base_dir: str) -> str:
+    """package.toml's [links] table: each library name mapped to its file per platform, relative to base_dir."""
+    table: Dict[str, Dict[str, str]] = {}
+    for library in libraries:
+        entries = table.setdefault(library.name, {})
+        for platform in sorted(library.symbols):
+            if platform in entries:
+                log.warning("%s: %s already links %s on %s", library.path, library.name, entries[platform], platform)
+                continue
+            entries[platform] = os.path.relpath(os.path.abspath(library.path), base_dir).replace(os.sep, "/")
+    lines = ["[links]"]
+    for name, entries in table.items():
+        pairs = ", ".join(f"{platform} = {_toml_string(path)}" for platform, path in entries.items())
+        lines.append(f"{name} = {{ {pairs} }}")
+    return "\n".join(lines) + "\n"
+
+
+def update_package_toml(path: str, libraries: List[Library]) -> bool:
+    """
+    Replace the [links] table of the package.toml at path, keeping the rest
+    of the file as written, or create a minimal one. Returns whether it wrote.
+    """
+    table = links_table(libraries, os.path.dirname(os.path.abspath(path)))
+    try:
+        with open(path) as f:
+            text = f.read()
+    except FileNotFoundError:
+        name = os.path.basename(os.path.dirname(os.path.abspath(path))) or "bindings"
+        return write_if_changed(path, f'name = {json.dumps(name)}\nversion = "1.0.0"\ntype = "lib"\n\n{table}')
+    lines = text.splitlines(keepends=True)
+    start = next((i for i, line in enumerate(lines) if line.strip() == "[links]"), None)
+    if start is None:
+        return write_if_changed(path, text.rstrip("\n") + "\n\n" + table)
+    end = next((i for i in range(start + 1, len(lines)) if lines[i].lstrip().startswith("[")), len(lines))
+    rest = "".join(lines[end:])
+    return write_if_changed(path, "".join(lines[:start]) + table + ("\n" + rest if rest else ""))
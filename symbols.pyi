@@ -0,0 +1,22 @@
+from dataclasses import dataclass, field
+
+SYMBOLS_VERSION: int
+
+@dataclass
+class Library:
+    name: str
+    path: str
+    symbols: dict[str, set[str]] = field(default_factory=dict)
+    @classmethod
+    def from_spec(cls, spec: str) -> Library: ...
+
+def read_library(path: str) -> dict[str, set[str]]: ...
+
+class SymbolIndex:
+    cache_dir: str | None
+    def __init__(self, cache_dir: str | None = None) -> None: ...
+    def load(self, library: Library): ...
+
+def verify_exports(model, libraries: list[Library], keep: bool = False) -> list[str]: ...
+def links_table(libraries: list[Library], base_dir: str) -> str: ...
+def update_package_toml(path: str, libraries: list[Library]) -> bool: ...
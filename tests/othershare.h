@@ -1,12 +1,19 @@
 #pragma once
 
 #include <stdio.h>
+#include <stdint.h>
 
 typedef struct {
     float x;
     float y;
 } Point;
 
+// Same size as PlayerHandle in share.h: --split must keep the accessors of both
+typedef union {
+    double d;
+    int64_t bits;
+} PointValue;
+
 const int POINT_MAX = 100;
 
 void draw_point(Point *point) {
@@ -9,6 +9,12 @@ typedef struct{
     char team[100];
 } Player;
 
+// Same size as PointValue in othershare.h
+typedef union {
+    int64_t raw;
+    void *ptr;
+} PlayerHandle;
+
 const int Color_RED = 0;
 const int Color_BLUE = 1;
 const int Color_GREEN = 2;
@@ -0,0 +1,28 @@
+// Records whose Nature layout needs explicit padding to match C's
+#include <stdint.h>
+
+// Only bitfields: stored as bytes, so Nature aligns it to 1 where C aligns it to 4
+struct Bits {
+    unsigned a : 3;
+    unsigned b : 5;
+};
+
+// C puts `bits` at offset 4; Nature needs _pad_1 to do the same
+struct NestedBits {
+    char tag;
+    struct Bits bits;
+    int32_t value;
+};
+
+// Nature ends this at 5 bytes without the trailing padding to C's 8
+struct TrailingBits {
+    struct Bits bits;
+    char tag;
+};
+
+#pragma pack(push, 1)
+struct PackedBits {
+    char tag;
+    struct Bits bits;
+};
+#pragma pack(pop)
@@ -0,0 +1,313 @@
+"""
+Header-only C code as native Nature functions, so callers do not cross the
+FFI boundary for it: expression-bodied function-like macros, and static
+inline functions whose body is a run of initialized declarations ending in a
+return. Works on token spellings and the model alone; main.py gathers the
+tokens from libclang. Whatever does not fit raises Untranslatable with the
+reason, for the generator to report.
+"""
+import dataclasses
+from typing import Dict, Iterable, List, Optional, Tuple
+
+from expr_ast import (CAST_TYPES, Binary, Call, Cast, CompoundLiteral, Conditional, Expr, Identifier,
+                      Member, Number, Param, String, Unary, has_call, literal_value, parse_macro_tokens,
+                      tokens_from_spellings)
+from out_types import Function, Parameter
+
+# Types of literals, which take the type of whatever they meet
+LIT_INT = "<int literal>"
+LIT_FLOAT = "<float literal>"
+# The type parameter every macro parameter gets
+GENERIC = "T"
+
+_INTS = {"i8": (8, True), "u8": (8, False), "i16": (16, True), "u16": (16, False), "i32": (32, True),
+         "u32": (32, False), "i64": (64, True), "u64": (64, False), "int": (64, True), "uint": (64, False)}
+_FLOATS = {"f32": 32, "f64": 64, "float": 64}
+_ARITHMETIC = ("+", "-", "*", "/", "%")
+_BITWISE = ("&", "|", "^")
+_COMPARISON = ("==", "!=", "<", ">", "<=", ">=")
+
+
+class Untranslatable(Exception):
+    """Raised with the reason when a macro or function body has no Nature equivalent here."""
+
+
+@dataclasses.dataclass
+class Statement:
+    """One statement of a static inline body: `ntype name = ...;` or `return ...;`."""
+    kind: str  # "var" or "return"
+    tokens: List[str] = dataclasses.field(default_factory=list)  # The expression's token spellings
+    name: str = ""
+    ntype: str = ""
+    items: Optional[List[List[str]]] = None  # Initializer list entries, for `T v = { a, b };`
+
+
+def _numeric(t: str) -> bool:
+    return t in _INTS or t in _FLOATS or t in (LIT_INT, LIT_FLOAT, GENERIC)
+
+
+def _common(a: str, b: str) -> str:
+    """The usual arithmetic conversions, on Nature types."""
+    if a == b:
+        return a
+    if not (_numeric(a) and _numeric(b)):
+        raise Untranslatable(f"mixes {a} and {b}")
+    if GENERIC in (a, b):
+        return GENERIC
+    if a in (LIT_INT, LIT_FLOAT) and b in (LIT_INT, LIT_FLOAT):
+        return LIT_FLOAT
+    if a in (LIT_INT, LIT_FLOAT):
+        a, b = b, a
+    if b == LIT_INT or (b == LIT_FLOAT and a in _FLOATS):
+        return a
+    if b == LIT_FLOAT:
+        return "f64"
+    if a in _FLOATS or b in _FLOATS:
+        return max((t for t in (a, b) if t in _FLOATS), key=lambda t: _FLOATS[t])
+    (bits_a, signed_a), (bits_b, signed_b) = _INTS[a], _INTS[b]
+    if max(bits_a, bits_b) < 32:
+        return "i32"
+    if bits_a != bits_b:
+        return a if bits_a > bits_b else b
+    return b if signed_a else a
+
+
+def _concrete(t: str) -> str:
+    return {LIT_INT: "i32", LIT_FLOAT: "f64"}.get(t, t)
+
+
+def _convert(text: str, source: str, target: str) -> str:
+    """text of type source, written so it has type target."""
+    if source == target or target == GENERIC:
+        return text
+    if source == GENERIC:
+        raise Untranslatable(f"converts a macro parameter to {target}")
+    if source == LIT_INT and target in _FLOATS and text.isdigit():
+        return f"{text}.0"
+    if source == LIT_INT and target in _INTS or source == LIT_FLOAT and target in _FLOATS:
+        return text
+    if target == "bool" and _numeric(source):
+        return f"({text} != 0)"
+    if not (_numeric(source) or source == "bool") or not _numeric(target):
+        raise Untranslatable(f"converts {source} to {target}")
+    return f"({text} as {target})"
+
+
+def _number(text: str) -> Tuple[str, str]:
+    value = literal_value(text)
+    if value is None:
+        raise Untranslatable(f"literal {text}")
+    if isinstance(value.value, float):
+        # 1.5f is a float in C, so it is never widened; 1.5 adapts to whatever it meets
+        ltype = "f32" if value.ctype == "float" else LIT_FLOAT
+        body = text.rstrip("fFlL")
+        if body.lower().startswith("0x"):
+            return repr(value.value), ltype
+        if body.startswith("."):
+            body = "0" + body
+        if body.endswith("."):
+            body += "0"
+        return body, ltype
+    if text.lower().startswith("0x"):
+        return text.rstrip("uUlL"), LIT_INT
+    return str(value.value), LIT_INT
+
+
+class Translator:
+    """Translates against one model: the constants, enums, records and functions macros may use."""
+
+    def __init__(self, model, reserved: Iterable[str] = ()):
+        self.model = model
+        self.reserved = frozenset(reserved)  # Nature keywords, which parameter names must avoid
+        self._enum_members = {m.name: f"{e.name}_{m.name}" for e in model.enums.values() for m in e.members}
+
+    # --- Expressions ---
+
+    def _expr(self, e: Expr, scope: Dict[str, Tuple[str, str]]) -> Tuple[str, str]:
+        """Nature text and type of e; scope maps C local names to (Nature name, type)."""
+        if isinstance(e, Number):
+            return _number(e.text)
+        if isinstance(e, String):
+            return f"{e.text}.ref()", "anyptr"
+        if isinstance(e, (Param, Identifier)):
+            if e.name in scope:
+                return scope[e.name]
+            const = self.model.constants.get(e.name)
+            if const is not None:
+                return const.name, const.ctype
+            if e.name in self._enum_members:
+                return self._enum_members[e.name], "int"
+            raise Untranslatable(f"unknown identifier {e.name}")
+        if isinstance(e, Unary):
+            if e.op == "!":
+                return f"!{self._cond(e.expr, scope)}", "bool"
+            text, t = self._expr(e.expr, scope)
+            if not _numeric(t) or (e.op == "~" and t in _FLOATS):
+                raise Untranslatable(f"{e.op} on {t}")
+            return f"{e.op}{text}", t
+        if isinstance(e, Cast):
+            text, t = self._expr(e.expr, scope)
+            return _convert(text, t, CAST_TYPES[e.type_name][3]), CAST_TYPES[e.type_name][3]
+        if isinstance(e, Binary):
+            return self._binary(e, scope)
+        if isinstance(e, Call):
+            return self._call(e, scope)
+        if isinstance(e, Member):
+            text, t = self._expr(e.expr, scope)
+            record = t[len("rawptr<"):-1] if e.arrow and t.startswith("rawptr<") else t
+            struct = self.model.structs.get(record)
+            fields = {f.name: f for f in struct.fields} if struct is not None else {}
+            field = fields.get(e.field)
+            if field is None or field.bit_width is not None:
+                raise Untranslatable(f"member {e.field} of {t}")
+            return f"{text}.{e.field}", field.ntype
+        if isinstance(e, CompoundLiteral):
+            return self._record_literal(e.type_name, [(it.field, it.value) for it in e.items], scope)
+        if isinstance(e, Conditional):
+            raise Untranslatable("conditional inside an expression")
+        raise Untranslatable(type(e).__name__)
+
+    def _cond(self, e: Expr, scope) -> str:
+        text, t = self._expr(e, scope)
+        return _convert(text, t, "bool")
+
+    def _binary(self, e: Binary, scope) -> Tuple[str, str]:
+        if e.op in ("&&", "||"):
+            return f"({self._cond(e.left, scope)} {e.op} {self._cond(e.right, scope)})", "bool"
+        left, lt = self._expr(e.left, scope)
+        right, rt = self._expr(e.right, scope)
+        if e.op in ("<<", ">>"):
+            # The result has the promoted type of the left operand
+            if LIT_FLOAT in (lt, rt) or lt in _FLOATS or rt in _FLOATS or not (_numeric(lt) and _numeric(rt)):
+                raise Untranslatable(f"shift of {lt} by {rt}")
+            result = lt if lt in (GENERIC, LIT_INT) else _common(lt, "i32")
+            return f"({_convert(left, lt, result)} {e.op} {_convert(right, rt, result)})", result
+        ctype = _common(lt, rt)
+        if e.op == "%" and ctype in _FLOATS or e.op in _BITWISE and (ctype in _FLOATS or ctype == LIT_FLOAT):
+            raise Untranslatable(f"{e.op} on {ctype}")
+        if e.op not in _ARITHMETIC + _BITWISE + _COMPARISON:
+            raise Untranslatable(f"operator {e.op}")
+        text = f"({_convert(left, lt, ctype)} {e.op} {_convert(right, rt, ctype)})"
+        return text, "bool" if e.op in _COMPARISON else ctype
+
+    def _call(self, e: Call, scope) -> Tuple[str, str]:
+        func = self.model.functions.get(e.func.name)
+        if func is None or func.is_variadic or len(func.parameters) != len(e.args):
+            raise Untranslatable(f"call to {e.func.name}")
+        args, types = [], []
+        for param, arg in zip(func.parameters, e.args):
+            text, t = self._expr(arg, scope)
+            args.append(_convert(text, t, param.ntype))
+            types.append(t)
+        ret = func.return_type
+        if ret == GENERIC and func.type_params:
+            # A translated macro: the result follows its arguments
+            ret = GENERIC if not types else types[0]
+            for t in types[1:]:
+                ret = _common(ret, t)
+        return f"{func.name}({', '.join(args)})", ret
+
+    def _record_literal(self, type_name: str, items: List[Tuple[Optional[str], Expr]], scope) -> Tuple[str, str]:
+        struct = self.model.structs.get(type_name)
+        if struct is None or any(f.bit_width is not None for f in struct.fields) or len(items) > len(struct.fields):
+            raise Untranslatable(f"initializer for {type_name}")
+        fields = {f.name: f for f in struct.fields}
+        pairs = []
+        for i, (name, value) in enumerate(items):
+            field = fields.get(name) if name else struct.fields[i]
+            if field is None:
+                raise Untranslatable(f"field {name} of {type_name}")
+            text, t = self._expr(value, scope)
+            pairs.append(f"{field.name}={_convert(text, t, field.ntype)}")
+        return f"{type_name}{{{', '.join(pairs)}}}", type_name
+
+    # --- Statements ---
+
+    def _returns(self, e: Expr, ret: str, scope) -> List[str]:
+        """Statements returning e as ret; a top-level conditional becomes if/else."""
+        if isinstance(e, Conditional):
+            lines = [f"if {self._cond(e.cond, scope)} {{"]
+            lines += [f"    {line}" for line in self._returns(e.then, ret, scope)]
+            return lines + ["}"] + self._returns(e.other, ret, scope)
+        text, t = self._expr(e, scope)
+        return [f"return {_convert(text, t, ret)}"]
+
+    def _result_type(self, e: Expr, scope) -> str:
+        if isinstance(e, Conditional):
+            a, b = self._result_type(e.then, scope), self._result_type(e.other, scope)
+            return a if a == b else _common(a, b)
+        return self._expr(e, scope)[1]
+
+    def macro(self, name: str, params: List[str], tokens: List[str], file: Optional[str] = None) -> Function:
+        """A generic Nature function for `#define name(params) tokens`."""
+        if "..." in params or any(p == "__VA_ARGS__" for p in params):
+            raise Untranslatable("variadic macro")
+        if any(t in ("#", "##") for t in tokens):
+            raise Untranslatable("stringizes or pastes tokens")
+        if not tokens:
+            raise Untranslatable("empty body")
+        expr = parse_macro_tokens(tokens_from_spellings(tokens), params)
+        if expr is None:
+            raise Untranslatable("body is not an expression")
+        names = [f"{p}_" if p in self.reserved else p for p in params]
+        scope = {p: (n, GENERIC) for p, n in zip(params, names)}
+        ret = _concrete(self._result_type(expr, scope))
+        return Function(name=name, c_name=name, return_type=ret,
+                        parameters=[Parameter(name=n, ntype=GENERIC) for n in names],
+                        file=file, body=self._returns(expr, ret, scope), type_params=[GENERIC] if params else [])
+
+    def inline(self, func: Function, c_params: List[str], statements: List[Statement]) -> List[str]:
+        """Nature body for a static inline function; c_params are its C parameter names."""
+        scope = {c: (p.name, p.ntype) for c, p in zip(c_params, func.parameters)}
+        body: List[str] = []
+        for i, stmt in enumerate(statements):
+            last = i == len(statements) - 1
+            if stmt.kind == "return" and last:
+                if func.return_type == "void":
+                    if stmt.tokens:
+                        raise Untranslatable("returns a value from void")
+                    break
+                body += self._returns(self._parse(stmt.tokens, "return value"), func.return_type, scope)
+            elif stmt.kind == "var" and not last:
+                if stmt.name in scope:
+                    raise Untranslatable(f"redeclares {stmt.name}")
+                if stmt.items is not None:
+                    items = [self._item(tokens) for tokens in stmt.items]
+                    text, _ = self._record_literal(stmt.ntype, items, scope)
+                    body.append(f"{stmt.ntype} {stmt.name} = {text}")
+                else:
+                    body += self._declare(stmt, self._parse(stmt.tokens, f"initializer of {stmt.name}"), scope)
+                scope[stmt.name] = (stmt.name, stmt.ntype)
+            else:
+                raise Untranslatable(f"{stmt.kind} statement")
+        if not body:
+            raise Untranslatable("empty body")
+        return body
+
+    def _declare(self, stmt: Statement, e: Expr, scope) -> List[str]:
+        if isinstance(e, Conditional):
+            # Both branches are side-effect free, so compute the else value and patch it
+            if has_call(e.then) or has_call(e.other):
+                raise Untranslatable(f"conditional with calls in {stmt.name}")
+            other, ot = self._expr(e.other, scope)
+            then, tt = self._expr(e.then, scope)
+            return [f"{stmt.ntype} {stmt.name} = {_convert(other, ot, stmt.ntype)}",
+                    f"if {self._cond(e.cond, scope)} {{",
+                    f"    {stmt.name} = {_convert(then, tt, stmt.ntype)}",
+                    "}"]
+        text, t = self._expr(e, scope)
+        return [f"{stmt.ntype} {stmt.name} = {_convert(text, t, stmt.ntype)}"]
+
+    def _item(self, tokens: List[str]) -> Tuple[Optional[str], Expr]:
+        """An initializer list entry, possibly designated (.x = 1)."""
+        if len(tokens) > 3 and tokens[0] == "." and tokens[2] == "=":
+            return tokens[1], self._parse(tokens[3:], f"initializer of {tokens[1]}")
+        return None, self._parse(tokens, "initializer")
+
+    @staticmethod
+    def _parse(tokens: List[str], what: str) -> Expr:
+        expr = parse_macro_tokens(tokens_from_spellings(tokens))
+        if expr is None:
+            raise Untranslatable(f"cannot parse {what}")
+        return expr
+
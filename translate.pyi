@@ -0,0 +1,26 @@
+from _typeshed import Incomplete
+from dataclasses import dataclass, field
+from expr_ast import Expr
+from out_types import Function
+from typing import Iterable
+
+LIT_INT: str
+LIT_FLOAT: str
+GENERIC: str
+
+class Untranslatable(Exception): ...
+
+@dataclass
+class Statement:
+    kind: str
+    tokens: list[str] = field(default_factory=list)
+    name: str = ...
+    ntype: str = ...
+    items: list[list[str]] | None = ...
+
+class Translator:
+    model: Incomplete
+    reserved: frozenset[str]
+    def __init__(self, model, reserved: Iterable[str] = ()) -> None: ...
+    def macro(self, name: str, params: list[str], tokens: list[str], file: str | None = None) -> Function: ...
+    def inline(self, func: Function, c_params: list[str], statements: list[Statement]) -> list[str]: ...
@@ -0,0 +1,125 @@
+import hashlib
+import json
+import os
+from typing import Dict, List, Optional
+
+from clang.cindex import (Index, TranslationUnit, TranslationUnitLoadError,
+                          TranslationUnitSaveError, conf)
+
+from depfile import hash_file
+from instrument import log, timings
+
+# Bump when the cache layout or the way entries are keyed changes
+CACHE_FORMAT_VERSION = 1
+
+
+def _clang_version() -> str:
+    try:
+        return str(conf.lib.clang_getClangVersion())
+    except Exception:
+        return "unknown"
+
+
+class TUCache:
+    """
+    On-disk cache of parsed translation units.
+
+    Entries are keyed by header path, clang args and libclang version, and are
+    only reused while the header and every file it transitively included hash
+    the same as when the entry was written. Two kinds of entry exist: the
+    saved TU used by BindingGenerator.parse_header, and a precompiled header
+    that MacroProcessor evaluation TUs include instead of the raw header.
+    """
+
+    def __init__(self, cache_dir: str):
+        self.cache_dir = cache_dir
+        os.makedirs(cache_dir, exist_ok=True)
+
+    def _key(self, kind: str, header_path: str, args: List[str]) -> str:
+        ident = json.dumps([CACHE_FORMAT_VERSION, kind, os.path.abspath(header_path), args, _clang_version()])
+        return hashlib.sha256(ident.encode()).hexdigest()[:32]
+
+    def _paths(self, key: str) -> tuple[str, str]:
+        base = os.path.join(self.cache_dir, key)
+        return f"{base}.ast", f"{base}.json"
+
+    def _is_fresh(self, key: str) -> bool:
+        ast_path, manifest_path = self._paths(key)
+        if not os.path.exists(ast_path):
+            return False
+        try:
+            with open(manifest_path) as f:
+                manifest = json.load(f)
+        except (OSError, ValueError):
+            return False
+        deps: Dict[str, str] = manifest.get("deps", {})
+        return bool(deps) and all(hash_file(path) == digest for path, digest in deps.items())
+
+    def _store(self, key: str, tu: TranslationUnit, header_path: str) -> bool:
+        ast_path, manifest_path = self._paths(key)
+        deps = {os.path.abspath(header_path)}
+        for inc in tu.get_includes():
+            deps.add(os.path.abspath(inc.include.name))
+        hashes = {path: hash_file(path) for path in sorted(deps)}
+        if any(digest is None for digest in hashes.values()):
+            return False
+
+        # Write to temporaries first so a concurrent reader never sees half an entry; they
+        # are per process because macro evaluation workers can rebuild the same PCH at once
+        tmp = f".{os.getpid()}.tmp"
+        try:
+            tu.save(f"{ast_path}{tmp}")
+        except TranslationUnitSaveError as e:
+            log.debug("Could not save translation unit for %s: %s", header_path, e)
+            return False
+        with open(f"{manifest_path}{tmp}", "w") as f:
+            json.dump({"header": os.path.abspath(header_path), "deps": hashes}, f)
+        os.replace(f"{ast_path}{tmp}", ast_path)
+        os.replace(f"{manifest_path}{tmp}", manifest_path)
+        return True
+
+    def invalidate(self, kind: str, header_path: str, args: List[str]):
+        for path in self._paths(self._key(kind, header_path, args)):
+            try:
+                os.remove(path)
+            except OSError:
+                pass
+
+    def parse(self, index: Index, header_path: str, args: List[str], options: int) -> TranslationUnit:
+        """Load the TU for header_path from the cache, or parse it and cache the result."""
+        key = self._key("tu", header_path, args + [str(options)])
+        ast_path, _ = self._paths(key)
+        if self._is_fresh(key):
+            try:
+                tu = TranslationUnit.from_ast_file(ast_path, index)
+                log.debug("Loaded cached translation unit for %s", header_path)
+                timings.count("tu cache hits")
+                return tu
+            except TranslationUnitLoadError as e:
+                log.debug("Cached translation unit unusable, reparsing: %s", e)
+
+        tu = index.parse(header_path, args=args, options=options)
+        if tu:
+            self._store(key, tu, header_path)
+        return tu
+
+    def macro_pch(self, header_path: str, args: List[str]) -> Optional[str]:
+        """
+        Path to a precompiled header of header_path built with args, for
+        MacroProcessor evaluation TUs to pass via -include-pch. Built on demand;
+        callers remember the answer (including None) for the rest of their run.
+        """
+        key = self._key("pch", header_path, args)
+        ast_path, _ = self._paths(key)
+        if self._is_fresh(key):
+            return ast_path
+
+        index = Index.create()
+        try:
+            tu = index.parse(header_path, args=['-x', 'c-header'] + args, options=TranslationUnit.PARSE_INCOMPLETE)
+        except TranslationUnitLoadError as e:
+            log.debug("Could not build PCH for %s: %s", header_path, e)
+            return None
+        if any(d.severity >= d.Fatal for d in tu.diagnostics):
+            return None
+        return ast_path if self._store(key, tu, header_path) else None
@@ -0,0 +1,10 @@
+from clang.cindex import Index, TranslationUnit
+
+CACHE_FORMAT_VERSION: int
+
+class TUCache:
+    cache_dir: str
+    def __init__(self, cache_dir: str) -> None: ...
+    def invalidate(self, kind: str, header_path: str, args: list[str]) -> None: ...
+    def parse(self, index: Index, header_path: str, args: list[str], options: int) -> TranslationUnit: ...
+    def macro_pch(self, header_path: str, args: list[str]) -> str | None: ...
@@ -0,0 +1,51 @@
+import os
+import re
+from typing import Iterable, List, Optional, Set
+
+from instrument import log
+
+_COMMENT_OR_STRING_RE = re.compile(r"//[^\n]*|/\*[\s\S]*?\*/|\"(?:\\.|[^\"\\])*\"|'(?:\\.|[^'\\])*'")
+# import a.b.bindings [as x]  /  import "path/bindings.n" [as x]
+_IMPORT_RE = re.compile(r"^[ \t]*import[ \t]+([\w.]+|\"[^\"]*\"|'[^']*')(?:[ \t]+as[ \t]+(\w+))?", re.MULTILINE)
+_IDENT_RE = re.compile(r"[A-Za-z_]\w*")
+
+
+def _module_aliases(text: str, module: str) -> Set[str]:
+    """Names the source refers to the bindings module by."""
+    aliases = set()
+    for target, alias in _IMPORT_RE.findall(text):
+        if target[0] in "\"'":
+            stem = os.path.splitext(os.path.basename(target[1:-1]))[0]
+        else:
+            stem = target.rsplit(".", 1)[-1]
+        if stem == module:
+            aliases.add(alias or stem)
+    return aliases
+
+
+def find_references(paths: Iterable[str], module: str) -> Optional[Set[str]]:
+    """
+    Every `alias.Symbol` the Nature sources at paths use, where alias is how
+    they import the module named module (the output file's stem). None when
+    no source imports the module at all, so the caller can keep everything.
+    """
+    used: Set[str] = set()
+    imported = False
+    for path in paths:
+        with open(path, encoding="utf-8", errors="replace") as f:
+            text = f.read()
+        aliases = _module_aliases(text, module)
+        if not aliases:
+            log.debug("%s does not import %s", path, module)
+            continue
+        imported = True
+        # Blank out comments and string literals; "x.ref()" is not a reference
+        code = _COMMENT_OR_STRING_RE.sub(" ", text)
+        alias_re = re.compile(r"(?<![\w.])(?:%s)\.([A-Za-z_]\w*)" % "|".join(map(re.escape, aliases)))
+        used.update(alias_re.findall(code))
+    return used if imported else None
+
+
+def type_names(ntype: str) -> List[str]:
+    """Identifiers inside a Nature type such as rawptr<Foo> or [Bar;4]."""
+    return _IDENT_RE.findall(ntype)
@@ -0,0 +1,4 @@
+from typing import Iterable
+
+def find_references(paths: Iterable[str], module: str) -> set[str] | None: ...
+def type_names(ntype: str) -> list[str]: ...